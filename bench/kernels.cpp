@@ -0,0 +1,449 @@
+/*
+ * Microbenchmarks of the kernels of the symmetrization on deterministic
+ * networks of the netgen generators. Built as sas_bench by module.make.
+ *
+ * sas_bench [-f filter] [-r repetitions] [-o JSON file] [-b baseline JSON]
+ *           [-t tolerance in percent]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../src/aig/global_bdd.h"
+#include "../src/aig/network.h"
+#include "../src/aig/symmetric.h"
+#include "../src/bdd/ch.h"
+#include "../src/bdd/storage.h"
+#include "../src/bdd/symmetric.h"
+#include "../src/commands/netgen.h"
+#include "../src/componentwise.h"
+#include "../src/utils/report.h"
+#include "../src/utils/truth_table.h"
+
+using namespace symmetrize;
+
+// +----------------------------------------------------------+
+// |                       Measurement                        |
+// +----------------------------------------------------------+
+
+// Allocations through operator new. ABC and CUDD allocate with malloc, their
+// memory only shows up in the peak resident set size.
+static size_t allocations = 0, allocated_bytes = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  allocated_bytes += size;
+  if (void *ptr = malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+// Resets the peak resident set size of the process (Linux 4.0 and later)
+static void ResetPeakRSS() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+}
+
+static size_t PeakRSS() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmHWM:", 0) == 0)
+      return std::stoul(line.substr(6)) * 1024;
+  }
+  return 0;
+}
+
+// Keeps the results of the kernels alive
+static volatile double sink;
+
+// Measures a single run of a kernel between Start and Stop
+class Measurement {
+public:
+  void Start() {
+    ResetPeakRSS();
+    rss_ = utils::ResourceUsage::Now().rss;
+    allocations_ = allocations;
+    allocated_bytes_ = allocated_bytes;
+    start_ = Clock::now();
+  }
+  void Stop() {
+    seconds = std::chrono::duration<double>(Clock::now() - start_).count();
+    allocations_ = allocations - allocations_;
+    allocated_bytes_ = allocated_bytes - allocated_bytes_;
+    size_t peak = PeakRSS();
+    peak_rss = peak > rss_ ? peak - rss_ : 0;
+  }
+
+  double seconds = 0;
+  // Growth of the peak resident set size during the run
+  size_t peak_rss = 0;
+  size_t Allocations() const { return allocations_; }
+  size_t AllocatedBytes() const { return allocated_bytes_; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point start_;
+  size_t rss_ = 0;
+  size_t allocations_ = 0, allocated_bytes_ = 0;
+};
+
+// Sets up its input, calls Start, runs the kernel, calls Stop and tears down
+using Kernel = std::function<void(Measurement &)>;
+
+// +----------------------------------------------------------+
+// |                         Inputs                           |
+// +----------------------------------------------------------+
+
+// A network of a netgen generator together with its global BDDs and their
+// nearest symmetric function
+struct Fixture {
+  Abc_Ntk_t *ntk;
+  size_t n;
+  bdd::BDDs f;
+  SymmetricFunction f_tilde;
+
+  Fixture(const std::string &type, size_t bits, size_t m) {
+    // The seed keeps the asymmetric networks the same across runs
+    ntk = commands::GenerateNetwork(type, bits, m, 1);
+    if (ntk == nullptr) {
+      throw std::runtime_error("generating " + type + " failed");
+    }
+    aig::GlobalBDDParameters param;
+    param.reorder = CUDD_REORDER_SIFT;
+    aig::BuildGlobalBDDs(ntk, param);
+    n = Abc_NtkPiNum(ntk);
+    f = aig::GetGlobalBDD(ntk);
+    BinomialCoefficients<ValueCount> binomial(n);
+    f_tilde = CalculateSymmetricFunction(bdd::C_H(f, n, binomial), binomial);
+  }
+  ~Fixture() {
+    // The BDDs have to be freed before their manager
+    f.components.clear();
+    Abc_NtkFreeGlobalBdds(ntk, 1);
+    Abc_NtkDelete(ntk);
+  }
+  Fixture(const Fixture &) = delete;
+  Fixture &operator=(const Fixture &) = delete;
+};
+
+struct Network {
+  std::string name, type;
+  size_t n, m;
+};
+
+static const std::vector<Network> NETWORKS = {
+    {"adder8", "adder", 8, 0},
+    {"adder16", "adder", 16, 0},
+    {"adder24", "adder", 24, 0},
+    {"multiplier6", "multiplier", 6, 0},
+    {"multiplier8", "multiplier", 8, 0},
+    {"multiplier10", "multiplier", 10, 0},
+    {"mac3x2", "mac", 3, 2},
+    {"mac4x2", "mac", 4, 2},
+    {"asymmetric10", "asymmetric", 10, 4},
+    {"asymmetric12", "asymmetric", 12, 4}};
+
+// Fixtures of NETWORKS, only built once a kernel on them runs. Cleared
+// before ABC is stopped.
+static std::vector<std::unique_ptr<Fixture>> fixtures;
+
+static Fixture &GetFixture(size_t i) {
+  fixtures.resize(NETWORKS.size());
+  if (!fixtures[i]) {
+    auto &net = NETWORKS[i];
+    fixtures[i] = std::make_unique<Fixture>(net.type, net.n, net.m);
+  }
+  return *fixtures[i];
+}
+
+// +----------------------------------------------------------+
+// |                         Kernels                          |
+// +----------------------------------------------------------+
+
+static void HammingDistances(Fixture &x, Measurement &measurement) {
+  double sum = 0;
+  size_t m = x.f.components.size();
+  measurement.Start();
+  for (size_t i = 0; i < m; i++) {
+    sum += x.f.components[i].HammingDistance(x.f.components[(i + 1) % m],
+                                             x.n);
+  }
+  measurement.Stop();
+  sink = sum;
+}
+
+static void CH(Fixture &x, Measurement &measurement) {
+  BinomialCoefficients<ValueCount> binomial(x.n);
+  measurement.Start();
+  auto Ts = bdd::C_H(x.f, x.n, binomial);
+  measurement.Stop();
+  sink = Ts[0][0];
+}
+
+static void Create(Fixture &x, Measurement &measurement) {
+  measurement.Start();
+  auto bdds = bdd::Create(x.f.GetManager(), x.f_tilde);
+  measurement.Stop();
+  sink = bdds.Count();
+}
+
+static void Write(Fixture &x, Measurement &measurement) {
+  std::ostringstream out;
+  measurement.Start();
+  bdd::Write(x.f, out);
+  measurement.Stop();
+  sink = out.str().size();
+}
+
+static void Read(Fixture &x, Measurement &measurement) {
+  std::stringstream stream;
+  bdd::Write(x.f, stream);
+  std::unique_ptr<DdManager, void (*)(DdManager *)> mgr(
+      bdd::NewManager(x.f.GetManager()), Cudd_Quit);
+  {
+    measurement.Start();
+    auto bdds = bdd::Read(stream, mgr.get());
+    measurement.Stop();
+    sink = bdds.Count();
+  }
+}
+
+// Realizes f_tilde by bit counters and MUX LUTs
+static void SymmetricNetwork(Fixture &x, Measurement &measurement) {
+  measurement.Start();
+  Abc_Ntk_t *ntk = aig::CreateSymmetricNetwork(x.f_tilde);
+  measurement.Stop();
+  sink = Abc_NtkNodeNum(ntk);
+  Abc_NtkDelete(ntk);
+}
+
+// Fills 64 random tables with the given amount of specified values, without
+// the results memoized by earlier runs
+static void FillMinBeads(size_t length, Measurement &measurement) {
+  std::mt19937 rng(length);
+  std::bernoulli_distribution value;
+  std::vector<PackedTruthTable> tables(64);
+  for (auto &table : tables) {
+    for (size_t i = 0; i < length; i++) {
+      table.PushBack(value(rng));
+    }
+  }
+  size_t sum = 0;
+  tt::ClearFillMinBeadsMemo();
+  measurement.Start();
+  for (auto &table : tables) {
+    sum += tt::FillMinBeads(table).size();
+  }
+  measurement.Stop();
+  sink = sum;
+}
+
+// Random instance with k items and a quarter of the total weight as capacity
+static void Knapsack(const std::string &solver, size_t k,
+                     Measurement &measurement) {
+  std::mt19937 rng(k);
+  std::uniform_real_distribution<double> weight(0, 1);
+  std::uniform_int_distribution<Profit> profit(1, 100);
+  std::vector<double> weights(k);
+  std::vector<Profit> profits(k);
+  double capacity = 0;
+  for (size_t i = 0; i < k; i++) {
+    weights[i] = weight(rng);
+    profits[i] = profit(rng);
+    capacity += weights[i] / 4;
+  }
+  auto knapsack_solver = KnapsackSolvers::Create(solver, 10);
+  measurement.Start();
+  auto solution = knapsack_solver->Optimize(weights, profits, capacity);
+  measurement.Stop();
+  sink = solution.profit;
+}
+
+static std::vector<std::pair<std::string, Kernel>> AllKernels() {
+  std::vector<std::pair<std::string, Kernel>> kernels;
+  std::vector<std::pair<std::string, void (*)(Fixture &, Measurement &)>>
+      on_networks = {{"hamming", HammingDistances},
+                     {"c_h", CH},
+                     {"create", Create},
+                     {"write", Write},
+                     {"read", Read},
+                     {"symmetric_aig", SymmetricNetwork}};
+  for (auto &kernel : on_networks) {
+    for (size_t i = 0; i < NETWORKS.size(); i++) {
+      auto fn = kernel.second;
+      kernels.emplace_back(kernel.first + "/" + NETWORKS[i].name,
+                           [fn, i](Measurement &measurement) {
+                             fn(GetFixture(i), measurement);
+                           });
+    }
+  }
+  for (size_t length : {33, 257, 4097}) {
+    kernels.emplace_back("fill_min_beads/" + std::to_string(length),
+                         [length](Measurement &measurement) {
+                           FillMinBeads(length, measurement);
+                         });
+  }
+  for (auto &solver : KnapsackSolvers::NAMES) {
+    for (size_t k : {64, 512}) {
+      kernels.emplace_back("knapsack/" + solver + "/" + std::to_string(k),
+                           [solver, k](Measurement &measurement) {
+                             Knapsack(solver, k, measurement);
+                           });
+    }
+  }
+  return kernels;
+}
+
+// +----------------------------------------------------------+
+// |                          Runner                          |
+// +----------------------------------------------------------+
+
+static const char *USAGE =
+    "sas_bench [-f filter] [-r repetitions] [-o JSON file] [-b baseline JSON]"
+    " [-t tolerance]\n"
+    "  runs the microbenchmarks of the symmetrization kernels\n"
+    "  -f: only run kernels whose name contains the filter\n"
+    "  -r: runs per kernel, the median time is reported (default: 5)\n"
+    "  -o: write the results as JSON, which serves as a later baseline\n"
+    "  -b: compare the median times with the given results of -o and exit\n"
+    "      with 1 if a kernel is slower by more than the tolerance\n"
+    "  -t: tolerance in percent (default: 10)\n";
+
+// Reads the median seconds per kernel from a file written with -o
+static std::map<std::string, double> ReadBaseline(const std::string &file) {
+  std::ifstream in(file);
+  if (!in) {
+    throw std::runtime_error("could not read baseline " + file);
+  }
+  const std::string median_key = "\"median_seconds\": ";
+  std::map<std::string, double> medians;
+  std::string line, kernel;
+  while (std::getline(in, line)) {
+    size_t quote = line.find('"'), open = line.find("\": {");
+    size_t median = line.find(median_key);
+    if (open != std::string::npos && quote < open) {
+      kernel = line.substr(quote + 1, open - quote - 1);
+    } else if (median != std::string::npos) {
+      medians[kernel] = std::stod(line.substr(median + median_key.size()));
+    }
+  }
+  return medians;
+}
+
+static int Run(const std::string &filter, size_t repetitions,
+               const std::string &output_file,
+               const std::string &baseline_file, double tolerance) {
+  std::map<std::string, double> baseline;
+  if (!baseline_file.empty()) {
+    baseline = ReadBaseline(baseline_file);
+  }
+
+  utils::Report report, kernel_reports;
+  report.Set("repetitions", repetitions);
+  size_t regressions = 0;
+  printf("%-28s %11s %11s %10s %12s %10s %8s\n", "kernel", "median ms",
+         "min ms", "allocs", "alloc bytes", "peak MB", "vs base");
+  for (auto &kernel : AllKernels()) {
+    if (kernel.first.find(filter) == std::string::npos)
+      continue;
+    std::vector<double> seconds;
+    Measurement measurement;
+    size_t peak_rss = 0;
+    for (size_t r = 0; r < repetitions; r++) {
+      kernel.second(measurement);
+      seconds.push_back(measurement.seconds);
+      peak_rss = std::max(peak_rss, measurement.peak_rss);
+    }
+    std::sort(seconds.begin(), seconds.end());
+    double median = seconds[seconds.size() / 2];
+
+    utils::Report k;
+    k.Set("median_seconds", median);
+    k.Set("min_seconds", seconds[0]);
+    k.Set("allocations", measurement.Allocations());
+    k.Set("allocated_bytes", measurement.AllocatedBytes());
+    k.Set("peak_rss_bytes", peak_rss);
+    std::string comparison = "-";
+    auto base = baseline.find(kernel.first);
+    if (base != baseline.end() && base->second > 0) {
+      double ratio = median / base->second;
+      k.Set("baseline_ratio", ratio);
+      char txt[16];
+      snprintf(txt, sizeof(txt), "%.2fx", ratio);
+      comparison = txt;
+      if (ratio > 1 + tolerance / 100) {
+        comparison += " !";
+        regressions++;
+      }
+    }
+    kernel_reports.Set(kernel.first, k);
+    printf("%-28s %11.3f %11.3f %10zu %12zu %10.2f %8s\n",
+           kernel.first.c_str(), 1e3 * median, 1e3 * seconds[0],
+           measurement.Allocations(), measurement.AllocatedBytes(),
+           peak_rss / 1048576.0, comparison.c_str());
+    fflush(stdout);
+  }
+  report.Set("kernels", kernel_reports);
+  if (!output_file.empty()) {
+    report.Write(output_file);
+  }
+  if (regressions) {
+    printf("%zu kernel(s) slower than the baseline by more than %.0f%%\n",
+           regressions, tolerance);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  std::string filter, output_file, baseline_file;
+  size_t repetitions = 5;
+  double tolerance = 10;
+  int c;
+  while ((c = getopt(argc, argv, "f:r:o:b:t:h")) != -1) {
+    if (c == 'f') {
+      filter = optarg;
+    } else if (c == 'r' && atoi(optarg) > 0) {
+      repetitions = atoi(optarg);
+    } else if (c == 'o') {
+      output_file = optarg;
+    } else if (c == 'b') {
+      baseline_file = optarg;
+    } else if (c == 't') {
+      tolerance = atof(optarg);
+    } else {
+      fputs(USAGE, stderr);
+      return 1;
+    }
+  }
+
+  Abc_Start();
+  int code;
+  try {
+    code = Run(filter, repetitions, output_file, baseline_file, tolerance);
+  } catch (std::exception &e) {
+    fprintf(stderr, "Exception caught: %s\n", e.what());
+    code = 1;
+  }
+  fixtures.clear();
+  Abc_Stop();
+  return code;
+}
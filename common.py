@@ -24,5 +24,13 @@ def read_time_command(time_command):
     return re.findall(r"elapse: ([\d.]+)", time_command[1])[0]
 
 
+def to_seconds(duration):
+    """Converts a duration in the format of timeout(1), e.g. 4h, to seconds"""
+    units = {"s": 1, "m": 60, "h": 3600, "d": 86400}
+    if duration[-1] in units:
+        return float(duration[:-1]) * units[duration[-1]]
+    return float(duration)
+
+
 def read_time(time_str):
     return re.findall(r"= *([\d.]+) sec", time_str)[0]
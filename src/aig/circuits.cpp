@@ -22,13 +22,13 @@ struct RMASState {
   const std::vector<Abc_Obj_t *> &inputs;
   std::vector<std::array<ValueCount, 2>> classes;
   std::vector<bool> current_in;
-  std::random_device dev;
   std::mt19937 rng;
   std::uniform_int_distribution<int> distr;
 
-  RMASState(Abc_Ntk_t *ntk, const std::vector<Abc_Obj_t *> &inputs)
+  RMASState(Abc_Ntk_t *ntk, const std::vector<Abc_Obj_t *> &inputs,
+            unsigned seed)
       : ntk(ntk), coefficients(inputs.size()), inputs(inputs),
-        classes(inputs.size() + 1), dev(), rng(dev()), distr(0, 1) {}
+        classes(inputs.size() + 1), rng(seed), distr(0, 1) {}
 };
 
 static Signal RandomMaximallyAsymmetric(RMASState &s) {
@@ -75,36 +75,50 @@ static Signal RandomMaximallyAsymmetric(RMASState &s) {
 }
 
 Signal RandomMaximallyAsymmetric(Abc_Ntk_t *ntk, const Signals &inputs) {
-  RMASState state(ntk, inputs);
+  return RandomMaximallyAsymmetric(ntk, inputs, std::random_device()());
+}
+
+Signal RandomMaximallyAsymmetric(Abc_Ntk_t *ntk, const Signals &inputs,
+                                 unsigned seed) {
+  RMASState state(ntk, inputs, seed);
   return RandomMaximallyAsymmetric(state);
 }
 
 // +----------------------------------------------------------+
 // |                           LUT                            |
 // +----------------------------------------------------------+
-template <typename TTIt, typename SIt>
-Signal MuxLUT(Abc_Ntk_t *ntk, TTIt tt_from, TTIt tt_to, SIt s_from, SIt s_to) {
-  size_t n = std::distance(tt_from, tt_to);
-  if (n == 1) {
+// Realizes the entries [begin, begin + n) of table, selected by the last
+// log2(n) signals of [s_from, s_to)
+static Signal MuxLUT(Abc_Ntk_t *ntk, const PackedTruthTable &table,
+                     size_t begin, size_t n, Number::const_iterator s_from,
+                     Number::const_iterator s_to) {
+  // Constant ranges yield constants anyway, as the AIG folds MUXes of equal
+  // constants
+  if (table.IsConstant(begin, n)) {
     Signal one = Abc_AigConst1(ntk);
-    return *tt_from ? one : Abc_ObjNot(one);
+    return table[begin] ? one : Abc_ObjNot(one);
   }
   Signal ctrl = *(--s_to);
   return Abc_AigMux(AIG(ntk), ctrl,
-                    MuxLUT(ntk, tt_from + n / 2, tt_to, s_from, s_to),
-                    MuxLUT(ntk, tt_from, tt_from + n / 2, s_from, s_to));
+                    MuxLUT(ntk, table, begin + n / 2, n / 2, s_from, s_to),
+                    MuxLUT(ntk, table, begin, n / 2, s_from, s_to));
 }
 
-Signal MuxLUT(Abc_Ntk_t *ntk, const TruthTable &table,
+Signal MuxLUT(Abc_Ntk_t *ntk, const PackedTruthTable &table,
               const Number &table_index) {
   if (!IsPow2(table.size()) || Log2(table.size()) != table_index.size()) {
     throw std::invalid_argument(
         "truth table has to be complete and of correct size for inputs");
   }
-  return MuxLUT(ntk, table.begin(), table.end(), table_index.begin(),
+  return MuxLUT(ntk, table, 0, table.size(), table_index.begin(),
                 table_index.end());
 }
 
+Signal MuxLUT(Abc_Ntk_t *ntk, const TruthTable &table,
+              const Number &table_index) {
+  return MuxLUT(ntk, PackedTruthTable(table), table_index);
+}
+
 // +----------------------------------------------------------+
 // |                        ARITHMETIC                        |
 // +----------------------------------------------------------+
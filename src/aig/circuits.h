@@ -25,12 +25,17 @@ using Number = Signals;
 //
 // Assumes ntk is an AIG
 Signal RandomMaximallyAsymmetric(Abc_Ntk_t *ntk, const Signals &inputs);
+// Same, but reproducible for the given seed
+Signal RandomMaximallyAsymmetric(Abc_Ntk_t *ntk, const Signals &inputs,
+                                 unsigned seed);
 
 // Creates a LUT for the given truth table returning the Signal corresponding to
 // "table[idx]"
 //
 // Assumes ntk is an AIG
 Signal MuxLUT(Abc_Ntk_t *ntk, const TruthTable &table, const Number &idx);
+Signal MuxLUT(Abc_Ntk_t *ntk, const PackedTruthTable &table,
+              const Number &idx);
 
 using NumberPair = std::pair<Number, Number>;
 using NumberPairs = std::vector<NumberPair>;
@@ -0,0 +1,421 @@
+#include "global_bdd.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include "../bdd/bdd.h"
+#include "../bdd/storage.h"
+#include "../utils/budget.h"
+#include "../utils/process.h"
+#include "../utils/trace.h"
+#include "network.h"
+
+namespace symmetrize {
+namespace aig {
+
+const std::map<std::string, VariableOrder> VARIABLE_ORDERS = {
+    {"natural", VariableOrder::NATURAL},
+    {"dfs", VariableOrder::DFS},
+    {"force", VariableOrder::FORCE},
+    {"interleave", VariableOrder::INTERLEAVE}};
+
+// +----------------------------------------------------------+
+// |                     Variable Orders                      |
+// +----------------------------------------------------------+
+
+static void VisitDFS(Abc_Obj_t *obj, std::vector<bool> &visited,
+                     std::vector<Abc_Obj_t *> &order) {
+  if (visited[Abc_ObjId(obj)])
+    return;
+  visited[Abc_ObjId(obj)] = true;
+  if (Abc_ObjIsNode(obj)) {
+    Abc_Obj_t *deeper = Abc_ObjFanin0(obj);
+    Abc_Obj_t *other = Abc_ObjFanin1(obj);
+    if (Abc_ObjLevel(other) > Abc_ObjLevel(deeper))
+      std::swap(deeper, other);
+    VisitDFS(deeper, visited, order);
+    VisitDFS(other, visited, order);
+  }
+  order.push_back(obj);
+}
+
+// Returns the CIs and nodes in depth-first post-order from the COs, visiting
+// the deeper fanin first. Unreachable CIs are appended.
+static std::vector<Abc_Obj_t *> DFSObjects(Abc_Ntk_t *ntk) {
+  Abc_NtkLevel(ntk);
+  std::vector<bool> visited(Abc_NtkObjNumMax(ntk), false);
+  std::vector<Abc_Obj_t *> order;
+  Abc_Obj_t *obj;
+  int i;
+  Abc_NtkForEachCo(ntk, obj, i) {
+    VisitDFS(Abc_ObjFanin0(obj), visited, order);
+  }
+  Abc_NtkForEachCi(ntk, obj, i) { VisitDFS(obj, visited, order); }
+  return order;
+}
+
+// Returns the CI indices in the order of the given objects
+static std::vector<int> CIOrder(Abc_Ntk_t *ntk,
+                                const std::vector<Abc_Obj_t *> &objects) {
+  std::vector<int> ci_index(Abc_NtkObjNumMax(ntk), -1);
+  Abc_Obj_t *obj;
+  int i;
+  Abc_NtkForEachCi(ntk, obj, i) { ci_index[Abc_ObjId(obj)] = i; }
+  std::vector<int> order;
+  for (auto *o : objects) {
+    if (ci_index[Abc_ObjId(o)] >= 0)
+      order.push_back(ci_index[Abc_ObjId(o)]);
+  }
+  return order;
+}
+
+// FORCE placement (Aloul et al., "FORCE: A Fast and Easy-to-Implement
+// Variable-Ordering Heuristic", GLSVLSI 2003) on the hyperedges formed by each
+// AND node and its fanins. Returns the objects in the order of the placement
+// with the smallest total span.
+static std::vector<Abc_Obj_t *> ForceObjects(Abc_Ntk_t *ntk) {
+  const size_t MAX_ITERATIONS = 20;
+  auto objects = DFSObjects(ntk);
+  std::vector<double> position(Abc_NtkObjNumMax(ntk), 0);
+  std::vector<std::vector<int>> edges;
+  std::vector<std::vector<size_t>> edges_of(Abc_NtkObjNumMax(ntk));
+  for (auto *obj : objects) {
+    if (!Abc_ObjIsNode(obj))
+      continue;
+    edges.push_back({Abc_ObjId(obj), Abc_ObjFaninId0(obj),
+                     Abc_ObjFaninId1(obj)});
+    for (int id : edges.back()) {
+      edges_of[id].push_back(edges.size() - 1);
+    }
+  }
+
+  auto best = objects;
+  double best_span = -1;
+  for (size_t iteration = 0; iteration <= MAX_ITERATIONS; iteration++) {
+    for (size_t p = 0; p < objects.size(); p++) {
+      position[Abc_ObjId(objects[p])] = p;
+    }
+    double span = 0;
+    std::vector<double> cog(edges.size());
+    for (size_t e = 0; e < edges.size(); e++) {
+      double min = position[edges[e][0]], max = min, sum = 0;
+      for (int id : edges[e]) {
+        min = std::min(min, position[id]);
+        max = std::max(max, position[id]);
+        sum += position[id];
+      }
+      span += max - min;
+      cog[e] = sum / edges[e].size();
+    }
+    if (best_span >= 0 && span >= best_span)
+      break;
+    best = objects;
+    best_span = span;
+
+    for (auto *obj : objects) {
+      auto &incident = edges_of[Abc_ObjId(obj)];
+      if (incident.empty())
+        continue;
+      double sum = 0;
+      for (size_t e : incident) {
+        sum += cog[e];
+      }
+      position[Abc_ObjId(obj)] = sum / incident.size();
+    }
+    std::stable_sort(objects.begin(), objects.end(),
+                     [&](Abc_Obj_t *a, Abc_Obj_t *b) {
+                       return position[Abc_ObjId(a)] < position[Abc_ObjId(b)];
+                     });
+  }
+  return best;
+}
+
+// Interleaves the bits of the blocks of PIs, i.e., takes the first PI of
+// every block, then the second one and so on
+static std::vector<int> InterleavedOrder(Abc_Ntk_t *ntk) {
+  auto blocks = GroupPIsByName(ntk);
+  std::vector<int> order;
+  for (size_t j = 0; order.size() < (size_t)Abc_NtkPiNum(ntk); j++) {
+    for (auto &block : blocks) {
+      if (j < block.size())
+        order.push_back(block[j]);
+    }
+  }
+  return order;
+}
+
+std::vector<int> ComputeVariableOrder(Abc_Ntk_t *ntk, VariableOrder order) {
+  switch (order) {
+  case VariableOrder::DFS:
+    return CIOrder(ntk, DFSObjects(ntk));
+  case VariableOrder::FORCE:
+    return CIOrder(ntk, ForceObjects(ntk));
+  case VariableOrder::INTERLEAVE:
+    if (Abc_NtkCiNum(ntk) != Abc_NtkPiNum(ntk))
+      throw std::invalid_argument("interleaved order requires combinatorial "
+                                  "logic");
+    return InterleavedOrder(ntk);
+  default:
+    std::vector<int> natural(Abc_NtkCiNum(ntk));
+    std::iota(natural.begin(), natural.end(), 0);
+    return natural;
+  }
+}
+
+// +----------------------------------------------------------+
+// |                        Building                          |
+// +----------------------------------------------------------+
+
+using ManagerPtr = std::unique_ptr<DdManager, void (*)(DdManager *)>;
+
+// Creates a manager with a variable for each CI of ntk in the given order
+static ManagerPtr NewManager(Abc_Ntk_t *ntk, std::vector<int> order,
+                             const GlobalBDDParameters &p) {
+  ManagerPtr mgr(
+      Cudd_Init(Abc_NtkCiNum(ntk), 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0),
+      Cudd_Quit);
+  if (!Cudd_ShuffleHeap(mgr.get(), order.data())) {
+    throw std::logic_error("Cudd_ShuffleHeap failed.");
+  }
+  if (p.reorder != CUDD_REORDER_NONE) {
+    Cudd_AutodynEnable(mgr.get(), p.reorder);
+  }
+  return mgr;
+}
+
+// Collects the AND nodes in the cone of obj in topological order
+static void CollectCone(Abc_Obj_t *obj, std::vector<bool> &visited,
+                        std::vector<Abc_Obj_t *> &nodes) {
+  if (!Abc_ObjIsNode(obj) || visited[Abc_ObjId(obj)])
+    return;
+  visited[Abc_ObjId(obj)] = true;
+  CollectCone(Abc_ObjFanin0(obj), visited, nodes);
+  CollectCone(Abc_ObjFanin1(obj), visited, nodes);
+  nodes.push_back(obj);
+}
+
+// Builds the BDDs of the COs with the given indices in mgr
+static bdd::BDDs BuildCOs(Abc_Ntk_t *ntk, const std::vector<int> &cos,
+                          DdManager *mgr, const GlobalBDDParameters &p,
+                          const utils::Budget &budget) {
+  utils::Span span("BuildCOs");
+  span.Arg("outputs", cos.size());
+  std::vector<bool> visited(Abc_NtkObjNumMax(ntk), false);
+  std::vector<Abc_Obj_t *> nodes;
+  for (int co : cos) {
+    CollectCone(Abc_ObjFanin0(Abc_NtkCo(ntk, co)), visited, nodes);
+  }
+
+  // BDDs of the objects, freed as soon as all fanouts have been built
+  std::vector<bdd::BDD> bdds(Abc_NtkObjNumMax(ntk));
+  std::vector<int> fanouts(Abc_NtkObjNumMax(ntk), 0);
+  bdds[Abc_ObjId(Abc_AigConst1(ntk))] = bdd::BDD(mgr, Cudd_ReadOne(mgr));
+  Abc_Obj_t *obj;
+  int i;
+  Abc_NtkForEachCi(ntk, obj, i) {
+    bdds[Abc_ObjId(obj)] = bdd::BDD(mgr, Cudd_bddIthVar(mgr, i));
+  }
+  auto fanin = [&](Abc_Obj_t *obj, int j) {
+    DdNode *node = bdds[Abc_ObjFaninId(obj, j)].Get();
+    return Cudd_NotCond(node, j == 0 ? Abc_ObjFaninC0(obj)
+                                     : Abc_ObjFaninC1(obj));
+  };
+  auto release = [&](int id) {
+    if (--fanouts[id] == 0)
+      bdds[id] = bdd::BDD();
+  };
+
+  for (auto *node : nodes) {
+    fanouts[Abc_ObjFaninId0(node)]++;
+    fanouts[Abc_ObjFaninId1(node)]++;
+  }
+  // BDDs of CO drivers are kept until the end
+  for (int co : cos) {
+    fanouts[Abc_ObjFaninId0(Abc_NtkCo(ntk, co))]++;
+  }
+  for (auto *node : nodes) {
+    if (budget.TimeExceeded()) {
+      throw std::runtime_error("time limit exceeded while building BDDs");
+    }
+    DdNode *res;
+    if (p.node_limit > 0) {
+      size_t live = Cudd_ReadKeys(mgr) - Cudd_ReadDead(mgr);
+      res = live < p.node_limit ? Cudd_bddAndLimit(mgr, fanin(node, 0),
+                                                   fanin(node, 1),
+                                                   p.node_limit - live)
+                                : nullptr;
+      if (res == nullptr) {
+        throw std::runtime_error("node limit exceeded while building BDDs");
+      }
+    } else {
+      res = Cudd_bddAnd(mgr, fanin(node, 0), fanin(node, 1));
+      if (res == nullptr) {
+        throw std::runtime_error("building BDDs failed");
+      }
+    }
+    bdds[Abc_ObjId(node)] = bdd::BDD(mgr, res);
+    release(Abc_ObjFaninId0(node));
+    release(Abc_ObjFaninId1(node));
+  }
+
+  bdd::BDDs result;
+  for (int co : cos) {
+    result.components.emplace_back(mgr, fanin(Abc_NtkCo(ntk, co), 0));
+  }
+  return result;
+}
+
+// Runs the final reordering and adds the statistics of mgr to stats
+static void Finish(DdManager *mgr, const GlobalBDDParameters &p,
+                   GlobalBDDStatistics &stats) {
+  if (p.reorder != CUDD_REORDER_NONE) {
+    Cudd_ReduceHeap(mgr, p.reorder, 1);
+    Cudd_AutodynDisable(mgr);
+  }
+  stats.peak_nodes =
+      std::max<size_t>(stats.peak_nodes, Cudd_ReadPeakNodeCount(mgr));
+  stats.reorderings += Cudd_ReadReorderings(mgr);
+  stats.reorder_seconds += Cudd_ReadReorderingTime(mgr) / 1000.0;
+}
+
+// Assigns the largest remaining cone to the currently smallest group
+std::vector<std::vector<int>> PartitionCOs(Abc_Ntk_t *ntk, size_t k) {
+  size_t m = Abc_NtkCoNum(ntk);
+  std::vector<size_t> sizes(m);
+  for (size_t co = 0; co < m; co++) {
+    sizes[co] = CountNodesFor({Abc_NtkCo(ntk, co)});
+  }
+  std::vector<int> by_size(m);
+  std::iota(by_size.begin(), by_size.end(), 0);
+  std::stable_sort(by_size.begin(), by_size.end(),
+                   [&](int a, int b) { return sizes[a] > sizes[b]; });
+
+  std::vector<std::vector<int>> groups(std::min(k, m));
+  std::vector<size_t> totals(groups.size(), 0);
+  for (int co : by_size) {
+    size_t g = std::min_element(totals.begin(), totals.end()) - totals.begin();
+    groups[g].push_back(co);
+    totals[g] += sizes[co];
+  }
+  for (auto &group : groups) {
+    std::sort(group.begin(), group.end());
+  }
+  return groups;
+}
+
+// Builds the BDDs of groups of COs in forked workers, each in a manager of
+// its own with the same initial order. The workers send their BDDs back in
+// the storage format, which are then merged into mgr. The workers do not
+// reorder, so that the merge does not have to rebuild each group under a
+// different order; the merged BDDs are reordered once by Finish.
+static bdd::BDDs BuildForked(Abc_Ntk_t *ntk, const std::vector<int> &order,
+                             DdManager *mgr, const GlobalBDDParameters &p,
+                             const utils::Budget &budget,
+                             GlobalBDDStatistics &stats) {
+  auto groups = PartitionCOs(ntk, p.workers);
+  GlobalBDDParameters worker_p = p;
+  worker_p.reorder = CUDD_REORDER_NONE;
+  auto job = [&](size_t g) {
+    auto worker_mgr = NewManager(ntk, order, worker_p);
+    std::ostringstream out(std::ios::binary);
+    {
+      auto bdds =
+          BuildCOs(ntk, groups[g], worker_mgr.get(), worker_p, budget);
+      GlobalBDDStatistics worker_stats;
+      Finish(worker_mgr.get(), worker_p, worker_stats);
+      out << worker_stats.peak_nodes << " " << worker_stats.reorderings << " "
+          << worker_stats.reorder_seconds << "\n";
+      bdd::Write(bdds, out);
+    }
+    return out.str();
+  };
+  double timeout = 0;
+  if (p.time_limit > 0) {
+    timeout = std::max(p.time_limit - budget.Elapsed(), 0.001);
+  }
+  auto results = utils::RunForked(groups.size(), p.workers, job, timeout);
+
+  // Merging in the initial order of the workers, reordering is resumed
+  // afterwards
+  Cudd_ReorderingType method;
+  bool autodyn = Cudd_ReorderingStatus(mgr, &method);
+  Cudd_AutodynDisable(mgr);
+  bdd::BDDs global;
+  global.components.resize(Abc_NtkCoNum(ntk));
+  for (size_t g = 0; g < groups.size(); g++) {
+    if (results[g].status == utils::ForkedResult::Status::TIMEOUT) {
+      throw std::runtime_error("time limit exceeded while building BDDs");
+    }
+    if (results[g].status != utils::ForkedResult::Status::SUCCESS) {
+      throw std::runtime_error("building BDDs of output group " +
+                               std::to_string(g) + " failed");
+    }
+    std::istringstream in(results[g].output, std::ios::binary);
+    GlobalBDDStatistics worker_stats;
+    in >> worker_stats.peak_nodes >> worker_stats.reorderings >>
+        worker_stats.reorder_seconds;
+    in.get();
+    stats.peak_nodes = std::max(stats.peak_nodes, worker_stats.peak_nodes);
+    stats.reorderings += worker_stats.reorderings;
+    stats.reorder_seconds += worker_stats.reorder_seconds;
+
+    auto bdds = bdd::Read(in, mgr);
+    for (size_t c = 0; c < groups[g].size(); c++) {
+      global.components[groups[g][c]] = bdds.components[c];
+    }
+  }
+  if (autodyn) {
+    Cudd_AutodynEnable(mgr, method);
+  }
+  return global;
+}
+
+DdManager *CreateManager(Abc_Ntk_t *ntk, const GlobalBDDParameters &p) {
+  return NewManager(ntk, ComputeVariableOrder(ntk, p.order), p).release();
+}
+
+bdd::BDDs BuildBDDs(Abc_Ntk_t *ntk, const std::vector<int> &cos,
+                    DdManager *mgr, const GlobalBDDParameters &p) {
+  utils::Budget budget(p.time_limit);
+  return BuildCOs(ntk, cos, mgr, p, budget);
+}
+
+GlobalBDDStatistics BuildGlobalBDDs(Abc_Ntk_t *ntk,
+                                    const GlobalBDDParameters &p) {
+  if (!Abc_NtkIsStrash(ntk)) {
+    throw std::invalid_argument("given network is not an AIG");
+  }
+  if (HasGlobalBDD(ntk)) {
+    throw std::invalid_argument("global BDD is already set");
+  }
+  utils::Span span("BuildGlobalBDDs");
+  span.Arg("outputs", Abc_NtkCoNum(ntk)).Arg("workers", p.workers);
+  utils::Budget budget(p.time_limit);
+  auto order = ComputeVariableOrder(ntk, p.order);
+
+  // Declared before all BDDs, so that they are freed before the manager
+  auto mgr = NewManager(ntk, order, p);
+  GlobalBDDStatistics stats;
+  bdd::BDDs global;
+  if (p.workers > 1 && Abc_NtkCoNum(ntk) > 1) {
+    global = BuildForked(ntk, order, mgr.get(), p, budget, stats);
+  } else {
+    std::vector<int> cos(Abc_NtkCoNum(ntk));
+    std::iota(cos.begin(), cos.end(), 0);
+    global = BuildCOs(ntk, cos, mgr.get(), p, budget);
+  }
+  Finish(mgr.get(), p, stats);
+  stats.seconds = budget.Elapsed();
+  span.Arg("peak_nodes", stats.peak_nodes);
+
+  // The network takes ownership of the manager
+  SetGlobalBDDs(ntk, global);
+  mgr.release();
+  return stats;
+}
+
+} // namespace aig
+} // namespace symmetrize
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * Contains a builder for the global BDDs of an AIG with structural variable
+ * order heuristics and resource limits
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../bdd/bdd.h"
+#include "../includes.h"
+
+namespace symmetrize {
+namespace aig {
+
+enum class VariableOrder {
+  // Order of the CIs
+  NATURAL,
+  // Order in which a depth-first traversal from the COs reaches the CIs,
+  // visiting the deeper fanin first
+  DFS,
+  // FORCE placement: starting from the DFS order, every object is moved to
+  // the average center of gravity of the AND nodes it belongs to
+  FORCE,
+  // Interleaves the bits of the PI blocks (see GroupPIsByName), e.g., the
+  // operands of an adder or multiplier
+  INTERLEAVE
+};
+
+extern const std::map<std::string, VariableOrder> VARIABLE_ORDERS;
+
+// Returns the CI indices in the order of the BDD levels
+std::vector<int> ComputeVariableOrder(Abc_Ntk_t *ntk, VariableOrder order);
+
+struct GlobalBDDParameters {
+  VariableOrder order = VariableOrder::NATURAL;
+  // Dynamic reordering method, CUDD_REORDER_NONE disables reordering
+  Cudd_ReorderingType reorder = CUDD_REORDER_NONE;
+  // Maximum number of live BDD nodes and wall clock time in seconds
+  // (0 means unlimited)
+  size_t node_limit = 0;
+  double time_limit = 0;
+  // If larger than 1, the COs are partitioned into this many groups of
+  // similar cone size, which are built in forked worker processes in
+  // managers of their own (each subject to the node limit) and merged. The
+  // workers keep the initial order, dynamic reordering only runs on the
+  // merged BDDs.
+  size_t workers = 1;
+};
+
+// With several workers, the peak is the maximum over all managers and the
+// reorderings are summed up
+struct GlobalBDDStatistics {
+  double seconds = 0;
+  size_t peak_nodes = 0;
+  size_t reorderings = 0;
+  double reorder_seconds = 0;
+};
+
+// Builds the global BDDs of the COs of the AIG ntk in a new manager and
+// attaches them to ntk. If a limit is exceeded, all intermediate BDDs are
+// freed, ntk is left unchanged and std::runtime_error is thrown.
+GlobalBDDStatistics BuildGlobalBDDs(Abc_Ntk_t *ntk,
+                                    const GlobalBDDParameters &parameters);
+
+// Creates a manager with a variable for each CI of ntk (variable i belongs to
+// CI i) in the initial order and with the dynamic reordering of the
+// parameters. The caller owns the manager.
+DdManager *CreateManager(Abc_Ntk_t *ntk, const GlobalBDDParameters &parameters);
+
+// Builds the BDDs of the COs with the given indices in mgr (see
+// CreateManager), only touching their cones, subject to the limits of the
+// parameters
+bdd::BDDs BuildBDDs(Abc_Ntk_t *ntk, const std::vector<int> &cos,
+                    DdManager *mgr, const GlobalBDDParameters &parameters);
+
+// Partitions the indices of the COs into at most k groups with similar total
+// cone sizes, each sorted ascending
+std::vector<std::vector<int>> PartitionCOs(Abc_Ntk_t *ntk, size_t k);
+
+} // namespace aig
+} // namespace symmetrize
@@ -1,9 +1,12 @@
 #include "network.h"
 
 #include <bdd/extrab/extraBdd.h>
+#include <cctype>
+#include <map>
 #include <stdexcept>
 #include <unordered_set>
 
+#include "../utils/hash.h"
 #include "../utils/maths.h"
 #include "circuits.h"
 
@@ -31,6 +34,35 @@ Abc_Ntk_t *Create(size_t ni, size_t no, bool dummy_names) {
   return ntk;
 }
 
+// Deletes the networks in the backup chain starting at ntk
+static void DeleteBackups(Abc_Ntk_t *ntk) {
+  while (ntk != nullptr) {
+    Abc_Ntk_t *backup = Abc_NtkBackup(ntk);
+    Abc_NtkDelete(ntk);
+    ntk = backup;
+  }
+}
+
+Abc_Ntk_t *ExecuteOn(Abc_Frame_t *frame, Abc_Ntk_t *ntk,
+                     const std::string &command) {
+  // The command sees ntk without a backup, so that every network it leaves
+  // in the backup chain (including ntk, if replaced) can be deleted
+  Abc_Ntk_t *backup = Abc_NtkBackup(ntk);
+  Abc_NtkSetBackup(ntk, nullptr);
+  Abc_Ntk_t *current = frame->pNtkCur;
+  frame->pNtkCur = ntk;
+  int code = Cmd_CommandExecute(frame, command.c_str());
+  ntk = frame->pNtkCur;
+  frame->pNtkCur = current;
+  if (code) {
+    DeleteBackups(ntk);
+    throw std::runtime_error("command \"" + command + "\" failed");
+  }
+  DeleteBackups(Abc_NtkBackup(ntk));
+  Abc_NtkSetBackup(ntk, backup);
+  return ntk;
+}
+
 void SetName(Abc_Ntk_t *ntk, const std::string &name) {
   Abc_NtkSetName(ntk, Extra_UtilStrsav(name.c_str()));
 }
@@ -51,6 +83,50 @@ Signals GetPIs(Abc_Ntk_t *ntk) {
   return pis;
 }
 
+uint64_t Hash(Abc_Ntk_t *ntk) {
+  utils::Hasher hasher;
+  hasher.Add(Abc_NtkPiNum(ntk));
+  hasher.Add(Abc_NtkPoNum(ntk));
+  Abc_Obj_t *obj;
+  int i;
+  Abc_NtkForEachObj(ntk, obj, i) {
+    hasher.Add(Abc_ObjId(obj));
+    hasher.Add(Abc_ObjType(obj));
+    for (int j = 0; j < Abc_ObjFaninNum(obj); j++) {
+      hasher.Add(Abc_ObjFaninId(obj, j));
+      hasher.Add(j == 0 ? Abc_ObjFaninC0(obj) : Abc_ObjFaninC1(obj));
+    }
+  }
+  return hasher.Get();
+}
+
+InputBlocks GroupPIsByName(Abc_Ntk_t *ntk) {
+  std::map<std::string, size_t> block_of_prefix;
+  InputBlocks blocks;
+  Abc_Obj_t *pi;
+  int i;
+  Abc_NtkForEachPi(ntk, pi, i) {
+    std::string name = Abc_ObjName(pi);
+    size_t end = name.find('[');
+    if (end == std::string::npos) {
+      end = name.size();
+      while (end > 0 && isdigit(name[end - 1]))
+        end--;
+    }
+    auto it = block_of_prefix.emplace(name.substr(0, end), blocks.size()).first;
+    if (it->second == blocks.size())
+      blocks.emplace_back();
+    blocks[it->second].push_back(i);
+  }
+  if (blocks.size() == 1 && blocks[0].size() > 1) {
+    auto &all = blocks[0];
+    size_t h = all.size() / 2;
+    blocks = {std::vector<int>(all.begin(), all.begin() + h),
+              std::vector<int>(all.begin() + h, all.end())};
+  }
+  return blocks;
+}
+
 Signals AddPOs(Abc_Ntk_t *ntk, size_t n, bool dummy_names) {
   int n_before = Abc_NtkPoNum(ntk);
   Signals pos(n);
@@ -106,6 +182,20 @@ size_t CountNodesFor(const Signals &signals) {
   return set.size();
 }
 
+size_t Level(Signal signal) {
+  Abc_Obj_t *obj = Abc_ObjRegular(signal);
+  if (Abc_ObjIsCo(obj))
+    obj = Abc_ObjFanin0(obj);
+  return Abc_ObjLevel(obj);
+}
+
+size_t MaxLevel(const Signals &signals) {
+  size_t level = 0;
+  for (auto s : signals)
+    level = std::max(level, Level(s));
+  return level;
+}
+
 // +----------------------------------------------------------+
 // |                        GLOBAL BDD                        |
 // +----------------------------------------------------------+
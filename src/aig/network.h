@@ -26,6 +26,14 @@ bool CleanupAndCheck(Abc_Ntk_t *ntk);
 // and outputs if dummy_names is set to true.
 Abc_Ntk_t *Create(size_t ni = 0, size_t no = 0, bool dummy_names = true);
 
+// Executes command with ntk as the current network of frame and returns the
+// resulting network. The current network of frame is not changed. Ownership
+// of ntk is transferred: unless it is returned, ntk is deleted together with
+// all other networks the command left in the backup chain, also if the
+// command fails (std::runtime_error).
+Abc_Ntk_t *ExecuteOn(Abc_Frame_t *frame, Abc_Ntk_t *ntk,
+                     const std::string &command);
+
 // Sets the name of the given network to name.
 void SetName(Abc_Ntk_t *ntk, const std::string &name);
 
@@ -35,6 +43,11 @@ Signals GetPOs(Abc_Ntk_t *ntk);
 // Returns a vector of all PIs of the given network
 Signals GetPIs(Abc_Ntk_t *ntk);
 
+// Groups the PIs of ntk into blocks by their names without a trailing index,
+// e.g., a[3] and a3 belong to block a. If all PIs belong to the same block,
+// they are split into two halves instead (e.g. the operands of an adder).
+InputBlocks GroupPIsByName(Abc_Ntk_t *ntk);
+
 // For each signal in signals, adds a new PO to ntk and sets its fanin to the
 // signal. If dummy_names is set to true, a dummy name is assigned to the PO.
 void AddPOs(Abc_Ntk_t *ntk, const Signals &signals, bool dummy_names = true);
@@ -51,6 +64,17 @@ Signals AddPIs(Abc_Ntk_t *ntk, size_t n, bool dummy_names = true);
 // signals.
 size_t CountNodesFor(const Signals &signals);
 
+// Returns the level of the given signal or of the fanin of the given CO.
+// Requires the levels of the network to be up to date (see Abc_NtkLevel).
+size_t Level(Signal signal);
+
+// Returns the maximal level of the given signals
+size_t MaxLevel(const Signals &signals);
+
+// Hashes the structure of the AIG, i.e., the types, fanins and complemented
+// edges of all objects in the order of their IDs
+uint64_t Hash(Abc_Ntk_t *ntk);
+
 // Sets the global BDDs of ntk's COs to the given ones.
 void SetGlobalBDDs(Abc_Ntk_t *ntk, bdd::BDDs bdd);
 
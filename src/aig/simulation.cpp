@@ -0,0 +1,276 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "../utils/process.h"
+#include "../utils/trace.h"
+
+namespace symmetrize {
+namespace aig {
+
+using Word = uint64_t;
+
+// Every node is evaluated on BLOCK words at once. The patterns are split into
+// shards of SHARD words, each drawn from a generator seeded by its index.
+static constexpr size_t BLOCK = 4;
+static constexpr size_t SHARD = 256;
+static constexpr Word ALL = ~(Word)0;
+
+// Structure of an AIG in terms of literals 2 * index + complemented. Index 0
+// is the constant one, 1 to n are the PIs and the AND nodes follow in
+// topological order.
+struct FlatAIG {
+  size_t n = 0;
+  // Two fanin literals per AND node
+  std::vector<uint32_t> fanins;
+  std::vector<uint32_t> outputs;
+};
+
+static FlatAIG Flatten(Abc_Ntk_t *ntk) {
+  FlatAIG aig;
+  aig.n = Abc_NtkPiNum(ntk);
+  std::vector<uint32_t> index(Abc_NtkObjNumMax(ntk), 0);
+  auto literal = [&](Abc_Obj_t *fanin, int complemented) {
+    return 2 * index[Abc_ObjId(fanin)] + complemented;
+  };
+  uint32_t next = 1;
+  Abc_Obj_t *obj;
+  int i;
+  Abc_NtkForEachPi(ntk, obj, i) { index[Abc_ObjId(obj)] = next++; }
+  Vec_Ptr_t *nodes = Abc_NtkDfs(ntk, 0);
+  aig.fanins.reserve(2 * Vec_PtrSize(nodes));
+  Vec_PtrForEachEntry(Abc_Obj_t *, nodes, obj, i) {
+    aig.fanins.push_back(literal(Abc_ObjFanin0(obj), Abc_ObjFaninC0(obj)));
+    aig.fanins.push_back(literal(Abc_ObjFanin1(obj), Abc_ObjFaninC1(obj)));
+    index[Abc_ObjId(obj)] = next++;
+  }
+  Vec_PtrFree(nodes);
+  Abc_NtkForEachPo(ntk, obj, i) {
+    aig.outputs.push_back(literal(Abc_ObjFanin0(obj), Abc_ObjFaninC0(obj)));
+  }
+  return aig;
+}
+
+// Evaluates all AND nodes, values has to contain BLOCK words per index with
+// the constant and the PIs already set
+static void Evaluate(const FlatAIG &aig, std::vector<Word> &values) {
+  Word *v = values.data();
+  Word *out = v + (1 + aig.n) * BLOCK;
+  for (size_t j = 0; j < aig.fanins.size(); j += 2, out += BLOCK) {
+    uint32_t a = aig.fanins[j], b = aig.fanins[j + 1];
+    const Word *va = v + (a >> 1) * BLOCK, *vb = v + (b >> 1) * BLOCK;
+    Word ca = -(Word)(a & 1), cb = -(Word)(b & 1);
+    for (size_t k = 0; k < BLOCK; k++) {
+      out[k] = (va[k] ^ ca) & (vb[k] ^ cb);
+    }
+  }
+}
+
+static Word Value(const std::vector<Word> &values, uint32_t literal,
+                  size_t k) {
+  return values[(literal >> 1) * BLOCK + k] ^ -(Word)(literal & 1);
+}
+
+// Values of PI i < 6 in each word when enumerating all patterns
+static const Word EXHAUSTIVE[6] = {
+    0xAAAAAAAAAAAAAAAA, 0xCCCCCCCCCCCCCCCC, 0xF0F0F0F0F0F0F0F0,
+    0xFF00FF00FF00FF00, 0xFFFF0000FFFF0000, 0xFFFFFFFF00000000};
+
+// Mismatch statistics of a single shard
+struct ShardResult {
+  std::vector<size_t> mismatches;
+  size_t joint_mismatches = 0;
+  std::vector<double> weighted_sums, weighted_squares;
+};
+
+class Comparison {
+public:
+  Comparison(FlatAIG a, FlatAIG b, const SimulationParameters &p,
+             const std::vector<std::vector<double>> &weights)
+      : a_(std::move(a)), b_(std::move(b)), p_(p), weights_(weights) {
+    exhaustive_ = a_.n <= p.exhaustive_limit && a_.n < 64;
+    if (exhaustive_) {
+      words_ = a_.n < 6 ? 1 : (size_t)1 << (a_.n - 6);
+      last_mask_ = a_.n < 6 ? ((Word)1 << (1 << a_.n)) - 1 : ALL;
+    } else {
+      words_ = std::max<size_t>((p.patterns + 63) / 64, 1);
+      last_mask_ = ALL;
+    }
+  }
+
+  bool Exhaustive() const { return exhaustive_; }
+  size_t Patterns() const {
+    return exhaustive_ ? (size_t)1 << a_.n : 64 * words_;
+  }
+  size_t Shards() const { return (words_ + SHARD - 1) / SHARD; }
+
+  // Simulates the given shard, thread safe
+  ShardResult Run(size_t shard, std::vector<Word> &values_a,
+                  std::vector<Word> &values_b) const {
+    size_t n = a_.n, m = a_.outputs.size(), k_weights = weights_.size();
+    ShardResult res;
+    res.mismatches.assign(m, 0);
+    res.weighted_sums.assign(k_weights, 0);
+    res.weighted_squares.assign(k_weights, 0);
+    // Weighted error of each pattern of the current word
+    std::vector<double> y(64 * k_weights, 0);
+
+    std::seed_seq seq{(uint32_t)p_.seed, (uint32_t)(p_.seed >> 32),
+                      (uint32_t)shard};
+    std::mt19937_64 rng(seq);
+    size_t end = std::min(words_, (shard + 1) * SHARD);
+    std::fill_n(values_a.begin(), BLOCK, ALL);
+    std::fill_n(values_b.begin(), BLOCK, ALL);
+    for (size_t w = shard * SHARD; w < end; w += BLOCK) {
+      for (size_t i = 0; i < n; i++) {
+        Word *in = values_a.data() + (1 + i) * BLOCK;
+        for (size_t k = 0; k < BLOCK; k++) {
+          if (!exhaustive_)
+            in[k] = rng();
+          else if (i < 6)
+            in[k] = EXHAUSTIVE[i];
+          else
+            in[k] = ((w + k) >> (i - 6)) & 1 ? ALL : 0;
+        }
+        std::copy_n(in, BLOCK, values_b.data() + (1 + i) * BLOCK);
+      }
+      Evaluate(a_, values_a);
+      Evaluate(b_, values_b);
+
+      for (size_t k = 0; k < BLOCK; k++) {
+        Word mask = ALL;
+        if (w + k >= words_)
+          mask = 0;
+        else if (w + k + 1 == words_)
+          mask = last_mask_;
+        Word any = 0;
+        for (size_t i = 0; i < m; i++) {
+          Word diff = (Value(values_a, a_.outputs[i], k) ^
+                       Value(values_b, b_.outputs[i], k)) &
+                      mask;
+          if (!diff)
+            continue;
+          res.mismatches[i] += __builtin_popcountll(diff);
+          any |= diff;
+          for (; k_weights && diff; diff &= diff - 1) {
+            size_t bit = __builtin_ctzll(diff);
+            for (size_t l = 0; l < k_weights; l++) {
+              y[64 * l + bit] += weights_[l][i];
+            }
+          }
+        }
+        res.joint_mismatches += __builtin_popcountll(any);
+        for (; k_weights && any; any &= any - 1) {
+          size_t bit = __builtin_ctzll(any);
+          for (size_t l = 0; l < k_weights; l++) {
+            double value = y[64 * l + bit];
+            res.weighted_sums[l] += value;
+            res.weighted_squares[l] += value * value;
+            y[64 * l + bit] = 0;
+          }
+        }
+      }
+    }
+    return res;
+  }
+
+  // Value buffer of a network for Run
+  std::vector<Word> ValuesA() const { return Values(a_); }
+  std::vector<Word> ValuesB() const { return Values(b_); }
+
+private:
+  static std::vector<Word> Values(const FlatAIG &aig) {
+    return std::vector<Word>((1 + aig.n + aig.fanins.size() / 2) * BLOCK);
+  }
+
+  FlatAIG a_, b_;
+  const SimulationParameters &p_;
+  const std::vector<std::vector<double>> &weights_;
+  bool exhaustive_;
+  size_t words_;
+  // Valid patterns of the last word
+  Word last_mask_;
+};
+
+SimulationResult Simulate(Abc_Ntk_t *ntk, Abc_Ntk_t *reference,
+                          const SimulationParameters &p,
+                          const std::vector<std::vector<double>> &weights) {
+  if (!Abc_NtkIsStrash(ntk) || !Abc_NtkIsStrash(reference)) {
+    throw std::invalid_argument("given network is not an AIG");
+  }
+  if (Abc_NtkLatchNum(ntk) || Abc_NtkLatchNum(reference)) {
+    throw std::invalid_argument("sequential networks are not supported");
+  }
+  if (Abc_NtkPiNum(ntk) != Abc_NtkPiNum(reference) ||
+      Abc_NtkPoNum(ntk) != Abc_NtkPoNum(reference)) {
+    throw std::invalid_argument("networks differ in the number of PIs/POs");
+  }
+  size_t m = Abc_NtkPoNum(ntk);
+  for (auto &w : weights) {
+    if (w.size() != m) {
+      throw std::invalid_argument("expected one weight per PO");
+    }
+  }
+  Comparison cmp(Flatten(ntk), Flatten(reference), p, weights);
+  size_t n_shards = cmp.Shards();
+  size_t n_threads = p.threads ? p.threads : utils::HardwareConcurrency();
+  n_threads = std::min(n_threads, n_shards);
+  utils::Span span("Simulate");
+  span.Arg("patterns", cmp.Patterns()).Arg("threads", n_threads);
+
+  // Shards are merged in order, so that the sums do not depend on the
+  // threads
+  std::vector<ShardResult> shards(n_shards);
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::atomic<bool> failed(false);
+  auto work = [&]() {
+    try {
+      auto values_a = cmp.ValuesA();
+      auto values_b = cmp.ValuesB();
+      for (size_t s; !failed && (s = next++) < n_shards;) {
+        shards[s] = cmp.Run(s, values_a, values_b);
+      }
+    } catch (...) {
+      if (!failed.exchange(true))
+        error = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < n_threads; t++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  SimulationResult res;
+  res.exhaustive = cmp.Exhaustive();
+  res.patterns = cmp.Patterns();
+  res.mismatches.assign(m, 0);
+  res.weighted_sums.assign(weights.size(), 0);
+  res.weighted_squares.assign(weights.size(), 0);
+  for (auto &shard : shards) {
+    for (size_t i = 0; i < m; i++) {
+      res.mismatches[i] += shard.mismatches[i];
+    }
+    res.joint_mismatches += shard.joint_mismatches;
+    for (size_t l = 0; l < weights.size(); l++) {
+      res.weighted_sums[l] += shard.weighted_sums[l];
+      res.weighted_squares[l] += shard.weighted_squares[l];
+    }
+  }
+  return res;
+}
+
+} // namespace aig
+} // namespace symmetrize
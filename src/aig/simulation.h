@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * Contains a word-parallel simulator that compares the POs of two AIGs on
+ * random or exhaustive input patterns
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "../includes.h"
+
+namespace symmetrize {
+namespace aig {
+
+struct SimulationParameters {
+  // Number of random patterns, rounded up to a multiple of 64
+  size_t patterns = 1 << 20;
+  // All 2^n patterns are simulated instead if the networks have at most this
+  // many PIs
+  size_t exhaustive_limit = 20;
+  // Worker threads, 0 means one per hardware thread
+  size_t threads = 0;
+  // The random patterns only depend on the seed, not on the threads
+  uint64_t seed = 0;
+};
+
+struct SimulationResult {
+  bool exhaustive = false;
+  size_t patterns = 0;
+  // Number of patterns on which PO i differs
+  std::vector<size_t> mismatches;
+  // Number of patterns on which any PO differs
+  size_t joint_mismatches = 0;
+  // For each weight vector w given to Simulate, the sum and the sum of
+  // squares of sum_i w_i * [PO i differs] over all patterns
+  std::vector<double> weighted_sums;
+  std::vector<double> weighted_squares;
+};
+
+// Simulates the AIGs ntk and reference with the same patterns, PI i of ntk
+// receiving the values of PI i of reference, and counts the mismatches of
+// their POs. Both networks have to be AIGs with the same number of PIs and
+// POs (std::invalid_argument otherwise). The networks are only read, the
+// threads work on a copy of their structure.
+SimulationResult Simulate(Abc_Ntk_t *ntk, Abc_Ntk_t *reference,
+                          const SimulationParameters &parameters,
+                          const std::vector<std::vector<double>> &weights = {});
+
+} // namespace aig
+} // namespace symmetrize
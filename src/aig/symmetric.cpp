@@ -4,18 +4,27 @@
 
 #include "circuits.h"
 
+#include "../utils/maths.h"
+#include "../utils/trace.h"
 #include "../utils/truth_table.h"
+#include "../utils/vector.h"
 
 namespace symmetrize {
 namespace aig {
 
 Signals AddSymmetricPOs(Abc_Ntk_t *ntk, const SymmetricFunction &f,
                         const Signals &inputs) {
-  Number sum = BitCounter(ntk, inputs);
+  utils::Span span("AddSymmetricPOs");
+  span.Arg("components", f.components.size());
+  Signals literals = inputs;
+  for (size_t i = 0; i < f.inverted_inputs.size(); i++) {
+    if (f.inverted_inputs[i])
+      literals.at(i) = Abc_ObjNot(literals.at(i));
+  }
+  Number sum = BitCounter(ntk, literals);
   Signals out(f.components.size());
   for (size_t i = 0; i < f.components.size(); i++) {
-    TruthTable tt = f.components[i];
-    tt = tt::FillMinBeads(tt);
+    auto tt = tt::FillMinBeads(PackedTruthTable(f.components[i]));
     out[i] = MuxLUT(ntk, tt, sum);
   }
   AddPOs(ntk, out);
@@ -30,6 +39,65 @@ Signals AddSymmetricPOs(Abc_Ntk_t *ntk, const SymmetricFunction &f) {
   return AddSymmetricPOs(ntk, f, GetPIs(ntk));
 }
 
+// Selects data[idx] using a multiplexer tree, data is padded to a power of two
+// by repeating its last entry
+static Signal MuxSignals(Abc_Ntk_t *ntk, Signals data, const Number &idx) {
+  data.resize(size_t(1) << idx.size(), data.back());
+  for (auto &ctrl : idx) {
+    Signals next(data.size() / 2);
+    for (size_t k = 0; k < next.size(); k++) {
+      next[k] = Abc_AigMux((Abc_Aig_t *)ntk->pManFunc, ctrl, data[2 * k + 1],
+                           data[2 * k]);
+    }
+    data = std::move(next);
+  }
+  return data[0];
+}
+
+// Realizes the entries offset + w_j * strides[j] + ... of tt where only the
+// blocks 0, ..., j are free
+static Signal RealizeBlocks(Abc_Ntk_t *ntk, const PackedTruthTable &tt,
+                            const std::vector<Number> &sums,
+                            const std::vector<size_t> &strides, size_t j,
+                            size_t offset) {
+  if (j == 0) {
+    return MuxLUT(ntk, tt::FillMinBeads(tt.Slice(offset, strides[1])),
+                  sums[0]);
+  }
+  size_t radix = strides[j + 1] / strides[j];
+  Signals data(radix);
+  for (size_t w = 0; w < radix; w++) {
+    data[w] =
+        RealizeBlocks(ntk, tt, sums, strides, j - 1, offset + w * strides[j]);
+  }
+  return MuxSignals(ntk, data, sums[j]);
+}
+
+Signals AddBlockSymmetricPOs(Abc_Ntk_t *ntk, const BlockSymmetricFunction &f) {
+  if (f.n != Abc_NtkPiNum(ntk)) {
+    throw std::invalid_argument("invalid amount of network inputs");
+  }
+  if (f.blocks.empty()) {
+    throw std::invalid_argument("block symmetric function without blocks");
+  }
+  Signals pis = GetPIs(ntk);
+  std::vector<Number> sums;
+  for (auto &block : f.blocks) {
+    sums.push_back(BitCounter(
+        ntk, utils::Subset(pis, std::vector<size_t>(block.begin(),
+                                                    block.end()))));
+  }
+  auto strides = MixedRadixStrides(BlockRadices(f.blocks));
+  Signals out(f.components.size());
+  for (size_t i = 0; i < f.components.size(); i++) {
+    out[i] = RealizeBlocks(ntk, PackedTruthTable(f.components[i]), sums,
+                           strides, f.blocks.size() - 1, 0);
+  }
+  AddPOs(ntk, out);
+  Abc_AigCleanup((Abc_Aig_t *)ntk->pManFunc);
+  return out;
+}
+
 Abc_Ntk_t *CreateSymmetricNetwork(const SymmetricFunction &f) {
   Abc_Ntk_t *ntk = Create(f.n);
   AddSymmetricPOs(ntk, f);
@@ -10,10 +10,15 @@ namespace aig {
 // Adds POs realizing f with respect to ntk's PIs assuming ntk is an AIG
 Signals AddSymmetricPOs(Abc_Ntk_t *ntk, const SymmetricFunction &f);
 
-// Adds POs realizing f with respect inputs assuming ntk is an AIG
+// Adds POs realizing f with respect inputs assuming ntk is an AIG. Inverted
+// inputs of f are complemented before entering the bit counter.
 Signals AddSymmetricPOs(Abc_Ntk_t *ntk, const SymmetricFunction &f,
                         const Signals &inputs);
 
+// Adds POs realizing the block symmetric function f with respect to ntk's PIs
+// assuming ntk is an AIG. Uses one bit counter per block.
+Signals AddBlockSymmetricPOs(Abc_Ntk_t *ntk, const BlockSymmetricFunction &f);
+
 // Creates a new AIG realizing the given symmetric function
 Abc_Ntk_t *CreateSymmetricNetwork(const SymmetricFunction &f);
 
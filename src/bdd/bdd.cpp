@@ -13,6 +13,39 @@ int Level(DdNode *node, DdManager *manager, int n) {
   return Cudd_ReadPerm(manager, Cudd_NodeReadIndex(node));
 }
 
+DdManager *NewManager(DdManager *like) {
+  int vars = Cudd_ReadSize(like);
+  DdManager *manager =
+      Cudd_Init(vars, 0, CUDD_UNIQUE_SLOTS, CUDD_CACHE_SLOTS, 0);
+  std::vector<int> order(vars);
+  for (int i = 0; i < vars; i++) {
+    order[i] = Cudd_ReadInvPerm(like, i);
+  }
+  if (!Cudd_ShuffleHeap(manager, order.data())) {
+    Cudd_Quit(manager);
+    throw std::logic_error("Cudd_ShuffleHeap failed.");
+  }
+  return manager;
+}
+
+utils::Report Statistics(DdManager *manager) {
+  utils::Report report;
+  double hits = Cudd_ReadCacheHits(manager);
+  double lookups = Cudd_ReadCacheLookUps(manager);
+  report.Set("nodes", (size_t)Cudd_ReadNodeCount(manager));
+  report.Set("peak_nodes", (size_t)Cudd_ReadPeakNodeCount(manager));
+  report.Set("memory_bytes", (size_t)Cudd_ReadMemoryInUse(manager));
+  report.Set("cache_hits", hits);
+  report.Set("cache_lookups", lookups);
+  report.Set("cache_hit_rate", lookups > 0 ? hits / lookups : 0.0);
+  report.Set("garbage_collections",
+             (size_t)Cudd_ReadGarbageCollections(manager));
+  report.Set("gc_seconds", Cudd_ReadGarbageCollectionTime(manager) / 1000.0);
+  report.Set("reorderings", (size_t)Cudd_ReadReorderings(manager));
+  report.Set("reorder_seconds", Cudd_ReadReorderingTime(manager) / 1000.0);
+  return report;
+}
+
 // +----------------------------------------------------------+
 // |                           BDDs                           |
 // +----------------------------------------------------------+
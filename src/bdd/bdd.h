@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "../includes.h"
+#include "../utils/report.h"
 #include "../wae_factors.h"
 
 namespace symmetrize {
@@ -16,6 +17,13 @@ namespace bdd {
 // the given node for the current permutation of n variables in the manager.
 int Level(DdNode *node, DdManager *manager, int n);
 
+// Creates a new manager with the same variables and variable order as like
+DdManager *NewManager(DdManager *like);
+
+// Node counts, computed table hits, garbage collections and reorderings of
+// the manager
+utils::Report Statistics(DdManager *manager);
+
 class BDD {
 
 public:
@@ -1,7 +1,10 @@
 #include "ch.h"
 
+#include <stdexcept>
 #include <unordered_map>
 
+#include "../utils/trace.h"
+
 namespace symmetrize {
 namespace bdd {
 
@@ -10,6 +13,22 @@ namespace bdd {
 using Bin = const BinomialCoefficients<ValueCount> &;
 using Cache = std::unordered_map<DdNode *, ValueCountsHW>;
 
+static CacheStatistics cache_statistics;
+
+CacheStatistics ReadCacheStatistics() { return cache_statistics; }
+
+void ResetCacheStatistics() { cache_statistics = {}; }
+
+// Looks up b in cache, counting the lookup
+template <typename Map>
+static typename Map::iterator Lookup(Map &cache, DdNode *b) {
+  auto entry = cache.find(b);
+  cache_statistics.lookups++;
+  if (entry != cache.end())
+    cache_statistics.hits++;
+  return entry;
+}
+
 static ValueCountsHW ComplementValueCounts(ValueCountsHW v, Bin bin) {
   for (size_t i = 0; i < v.size(); i++) {
     v[i] = bin.at(v.size() - 1, i) - v[i];
@@ -51,7 +70,7 @@ static ValueCountsHW Count(DdNode *b, DdManager *mgr, int l, int n,
     return Expand(std::move(v), d, bin);
   }
   ValueCountsHW node_ch;
-  auto cache_entry = cache.find(b);
+  auto cache_entry = Lookup(cache, b);
   if (cache_entry != cache.end()) {
     node_ch = cache_entry->second;
   } else {
@@ -64,6 +83,8 @@ static ValueCountsHW Count(DdNode *b, DdManager *mgr, int l, int n,
 }
 
 std::vector<ValueCountsHW> C_H(const BDDs &bdds, int n, Bin bin) {
+  utils::Span span("C_H");
+  span.Arg("components", bdds.components.size()).Arg("n", n);
   Cache cache;
   std::vector<ValueCountsHW> result;
   result.reserve(bdds.components.size());
@@ -73,5 +94,229 @@ std::vector<ValueCountsHW> C_H(const BDDs &bdds, int n, Bin bin) {
   return result;
 }
 
+// +----------------------------------------------------------+
+// |                         Polarity                         |
+// +----------------------------------------------------------+
+
+PolarityCounter::PolarityCounter(BDDs bdds, int n, Bin binomial)
+    : bdds_(std::move(bdds)), mgr_(bdds_.GetManager()), n_(n),
+      binomial_(binomial), inverted_(n, false), cache_(n) {}
+
+void PolarityCounter::SetInverted(int var, bool inverted) {
+  if (inverted_.at(var) == inverted)
+    return;
+  inverted_[var] = inverted;
+  // Tables of nodes below the variable stay valid
+  int level = Cudd_ReadPerm(mgr_, var);
+  for (int l = 0; l <= level; l++) {
+    cache_[l].clear();
+  }
+}
+
+ValueCountsHW PolarityCounter::Count(DdNode *b, int l) {
+  if (Cudd_IsComplement(b)) {
+    auto v = Count(Cudd_Regular(b), l);
+    return ComplementValueCounts(std::move(v), binomial_);
+  }
+  int l_curr = Level(b, mgr_, n_);
+  int d = l_curr - l;
+  if (Cudd_IsConstant(b)) {
+    ValueCountsHW v = {(ValueCount)(b == Cudd_ReadOne(mgr_))};
+    return Expand(std::move(v), d, binomial_);
+  }
+  auto &cache = cache_[l_curr];
+  auto cache_entry = Lookup(cache, b);
+  if (cache_entry == cache.end()) {
+    auto t = Count(Cudd_T(b), l_curr + 1);
+    auto e = Count(Cudd_E(b), l_curr + 1);
+    // The literal of an inverted variable is one in the else branch
+    auto node_ch = inverted_[Cudd_NodeReadIndex(b)]
+                       ? Combine(e, std::move(t))
+                       : Combine(t, std::move(e));
+    cache_entry = cache.emplace(b, std::move(node_ch)).first;
+  }
+  return Expand(cache_entry->second, d, binomial_);
+}
+
+std::vector<ValueCountsHW> PolarityCounter::C_H() {
+  utils::Span span("PolarityCounter::C_H");
+  span.Arg("components", bdds_.components.size()).Arg("n", n_);
+  std::vector<ValueCountsHW> result;
+  result.reserve(bdds_.components.size());
+  for (const BDD &bdd : bdds_.components) {
+    result.push_back(Count(bdd.Get(), 0));
+  }
+  return result;
+}
+
+// +----------------------------------------------------------+
+// |                      Block Symmetry                      |
+// +----------------------------------------------------------+
+
+// Combines the tables e (variable is zero) and t (variable is one) of the
+// variables below a variable of the block with the given radix and stride that
+// is one with probability p and stores the result in e. Counts are scaled by
+// 2 per variable, such that p = 1/2 yields plain amounts of inputs. t may be
+// the same table as e.
+static void CombineBlocks(ValueCountsHW &e, const ValueCountsHW &t,
+                          size_t radix, size_t stride, double p) {
+  double w_0 = 2 * (1 - p), w_1 = 2 * p;
+  // Descending, as t[idx - stride] has to be the old value if t is e
+  for (size_t idx = e.size(); idx-- > 0;) {
+    e[idx] *= w_0;
+    if ((idx / stride) % radix != 0)
+      e[idx] += w_1 * t[idx - stride];
+  }
+}
+
+static std::vector<double> UniformIfEmpty(const std::vector<double> &p,
+                                          int n) {
+  if (p.empty())
+    return std::vector<double>(n, 0.5);
+  if (p.size() != n)
+    throw std::invalid_argument("invalid amount of input probabilities");
+  for (double p_i : p) {
+    if (!(p_i >= 0 && p_i <= 1))
+      throw std::invalid_argument("input probability not in [0, 1]");
+  }
+  return p;
+}
+
+// Tables are indexed by per-block Hamming weights of the variables from a
+// level to the bottom. All tables have the same size, independent of the
+// level.
+class BlockCounter {
+
+public:
+  BlockCounter(DdManager *mgr, int n, const InputBlocks &blocks,
+               const std::vector<double> &probabilities);
+
+  ValueCountsHW Count(DdNode *b, int l);
+
+private:
+  // Expands table v of the variables from level to that of the variables from
+  // level l
+  ValueCountsHW Expand(ValueCountsHW v, int l, int level) const;
+
+  // Table of the constant one function over the variables from level l
+  const ValueCountsHW &One(int l);
+
+  DdManager *mgr_;
+  int n_;
+  std::vector<size_t> radices_, strides_;
+  std::vector<size_t> block_of_level_;
+  std::vector<double> p_of_level_;
+  std::vector<ValueCountsHW> ones_;
+  Cache cache_;
+};
+
+BlockCounter::BlockCounter(DdManager *mgr, int n, const InputBlocks &blocks,
+                           const std::vector<double> &probabilities)
+    : mgr_(mgr), n_(n), radices_(BlockRadices(blocks)),
+      strides_(MixedRadixStrides(radices_)), block_of_level_(n, blocks.size()),
+      p_of_level_(n), ones_(n + 1) {
+  // Keep the tables reasonably small
+  if (strides_.back() > (1 << 24)) {
+    throw std::invalid_argument("too many block weight combinations");
+  }
+  auto p = UniformIfEmpty(probabilities, n);
+  for (size_t j = 0; j < blocks.size(); j++) {
+    if (blocks[j].empty())
+      throw std::invalid_argument("empty input block");
+    for (int var : blocks[j]) {
+      if (var < 0 || var >= n)
+        throw std::invalid_argument("invalid input in block");
+      int level = Cudd_ReadPerm(mgr, var);
+      if (block_of_level_[level] != blocks.size())
+        throw std::invalid_argument("input contained in multiple blocks");
+      block_of_level_[level] = j;
+      p_of_level_[level] = p[var];
+    }
+  }
+  for (size_t j : block_of_level_) {
+    if (j == blocks.size())
+      throw std::invalid_argument("input not contained in any block");
+  }
+}
+
+ValueCountsHW BlockCounter::Expand(ValueCountsHW v, int l, int level) const {
+  for (int k = level - 1; k >= l; k--) {
+    size_t j = block_of_level_[k];
+    CombineBlocks(v, v, radices_[j], strides_[j], p_of_level_[k]);
+  }
+  return v;
+}
+
+const ValueCountsHW &BlockCounter::One(int l) {
+  if (ones_[l].empty()) {
+    ValueCountsHW v(strides_.back(), 0);
+    v[0] = 1;
+    ones_[l] = Expand(std::move(v), l, n_);
+  }
+  return ones_[l];
+}
+
+ValueCountsHW BlockCounter::Count(DdNode *b, int l) {
+  if (Cudd_IsComplement(b)) {
+    auto v = Count(Cudd_Regular(b), l);
+    auto &one = One(l);
+    for (size_t idx = 0; idx < v.size(); idx++) {
+      v[idx] = one[idx] - v[idx];
+    }
+    return v;
+  }
+  if (Cudd_IsConstant(b)) {
+    if (b == Cudd_ReadOne(mgr_))
+      return One(l);
+    return ValueCountsHW(strides_.back(), 0);
+  }
+  int l_curr = Level(b, mgr_, n_);
+  auto cache_entry = Lookup(cache_, b);
+  if (cache_entry == cache_.end()) {
+    auto t = Count(Cudd_T(b), l_curr + 1);
+    auto e = Count(Cudd_E(b), l_curr + 1);
+    size_t j = block_of_level_[l_curr];
+    CombineBlocks(e, t, radices_[j], strides_[j], p_of_level_[l_curr]);
+    cache_entry = cache_.emplace(b, std::move(e)).first;
+  }
+  return Expand(cache_entry->second, l, l_curr);
+}
+
+std::vector<ValueCountsHW> C_H(const BDDs &bdds, int n,
+                               const InputBlocks &blocks,
+                               const std::vector<double> &probabilities) {
+  utils::Span span("C_H blocks");
+  span.Arg("components", bdds.components.size())
+      .Arg("n", n)
+      .Arg("blocks", blocks.size());
+  std::vector<ValueCountsHW> result;
+  if (bdds.components.empty())
+    return result;
+  BlockCounter counter(bdds.GetManager(), n, blocks, probabilities);
+  result.reserve(bdds.components.size());
+  for (const BDD &bdd : bdds.components) {
+    result.push_back(counter.Count(bdd.Get(), 0));
+  }
+  return result;
+}
+
+ValueCountsHW BlockTotals(const InputBlocks &blocks,
+                          const std::vector<double> &probabilities) {
+  auto radices = BlockRadices(blocks);
+  auto strides = MixedRadixStrides(radices);
+  size_t n = 0;
+  for (auto &block : blocks)
+    n += block.size();
+  auto p = UniformIfEmpty(probabilities, n);
+  ValueCountsHW v(strides.back(), 0);
+  v[0] = 1;
+  for (size_t j = 0; j < blocks.size(); j++) {
+    for (int var : blocks[j]) {
+      CombineBlocks(v, v, radices[j], strides[j], p.at(var));
+    }
+  }
+  return v;
+}
+
 } // namespace bdd
 } // namespace symmetrize
@@ -1,15 +1,70 @@
 #pragma once
 
+#include <unordered_map>
+
 #include "../utils/maths.h"
 #include "bdd.h"
 
 namespace symmetrize {
 namespace bdd {
 
+// Lookups in the tables of already counted nodes and hits among them, summed
+// over all C_H computations since the last reset
+struct CacheStatistics {
+  size_t lookups = 0;
+  size_t hits = 0;
+};
+CacheStatistics ReadCacheStatistics();
+void ResetCacheStatistics();
+
 // Calculates C_H(f) for the function f with BDDs bdds, n variables and binomial
 // coefficients up to n over n.
 std::vector<ValueCountsHW>
 C_H(const BDDs &bdds, int n, const BinomialCoefficients<ValueCount> &binomial);
 
+// C_H with respect to literals, i.e., with some of the inputs complemented.
+// The tables of all nodes are kept per level, such that changing the polarity
+// of an input only recomputes the tables of the nodes above it.
+class PolarityCounter {
+
+public:
+  PolarityCounter(BDDs bdds, int n,
+                  const BinomialCoefficients<ValueCount> &binomial);
+
+  void SetInverted(int var, bool inverted);
+  const std::vector<bool> &Inverted() const { return inverted_; }
+
+  std::vector<ValueCountsHW> C_H();
+
+private:
+  ValueCountsHW Count(DdNode *b, int l);
+
+  BDDs bdds_;
+  DdManager *mgr_;
+  int n_;
+  const BinomialCoefficients<ValueCount> &binomial_;
+  std::vector<bool> inverted_;
+  // Tables of the nodes on each level
+  std::vector<std::unordered_map<DdNode *, ValueCountsHW>> cache_;
+};
+
+// Generalization of C_H for symmetry within blocks of inputs: calculates for
+// each component the amount of ones for every vector of per-block Hamming
+// weights (see BlockSymmetricFunction for the indexing). Every input has to be
+// contained in exactly one block.
+//
+// If probabilities are given, input i is one with probability
+// probabilities[i] and the inputs are weighted by their probability instead
+// of being counted. The weights are scaled by 2^n, such that uniform
+// probabilities yield the plain amounts.
+std::vector<ValueCountsHW> C_H(const BDDs &bdds, int n,
+                               const InputBlocks &blocks,
+                               const std::vector<double> &probabilities = {});
+
+// Weighted amount of all inputs for every vector of per-block Hamming weights
+// (scaled like C_H), i.e., C_H of the constant one function
+ValueCountsHW BlockTotals(const InputBlocks &blocks,
+                          const std::vector<double> &probabilities = {});
+
 } // namespace bdd
 } // namespace symmetrize
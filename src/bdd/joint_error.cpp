@@ -0,0 +1,89 @@
+#include "joint_error.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace symmetrize {
+namespace bdd {
+
+BDD Mismatch(const BDD &a, const BDD &b) {
+  if (a.GetManager() != b.GetManager()) {
+    throw std::invalid_argument("BDDs have to share a manager");
+  }
+  return {a.GetManager(), Cudd_bddXor(a.GetManager(), a.Get(), b.Get())};
+}
+
+using ProbabilityCache = std::unordered_map<DdNode *, double>;
+
+// Stores the probabilities of all visited nodes in cache. Nodes found in known
+// are not traversed any further.
+static double Probability(DdManager *manager, DdNode *node,
+                          const std::vector<double> &probabilities,
+                          ProbabilityCache &cache,
+                          const ProbabilityCache *known = nullptr) {
+  if (Cudd_IsComplement(node))
+    return 1 - Probability(manager, Cudd_Regular(node), probabilities, cache,
+                           known);
+  if (Cudd_IsConstant(node))
+    return node == Cudd_ReadOne(manager) ? 1 : 0;
+  auto it = cache.find(node);
+  if (it != cache.end())
+    return it->second;
+  if (known) {
+    auto known_it = known->find(node);
+    if (known_it != known->end())
+      return cache.emplace(node, known_it->second).first->second;
+  }
+  size_t var = Cudd_NodeReadIndex(node);
+  double p = probabilities.empty() ? 0.5 : probabilities.at(var);
+  double res =
+      p * Probability(manager, Cudd_T(node), probabilities, cache, known) +
+      (1 - p) *
+          Probability(manager, Cudd_E(node), probabilities, cache, known);
+  cache.emplace(node, res);
+  return res;
+}
+
+double Probability(const BDD &set, const std::vector<double> &probabilities) {
+  // Nodes are only cached during a single traversal, as unreferenced nodes
+  // may be freed and reused in between
+  ProbabilityCache cache;
+  return Probability(set.GetManager(), set.Get(), probabilities, cache);
+}
+
+JointError::JointError(DdManager *manager, size_t n,
+                       std::vector<double> probabilities)
+    : manager_(manager), probabilities_(std::move(probabilities)),
+      union_(manager, Cudd_ReadLogicZero(manager)) {
+  if (probabilities_.empty()) {
+    probabilities_.assign(n, 0.5);
+  } else if (probabilities_.size() != n) {
+    throw std::invalid_argument("invalid amount of input probabilities");
+  }
+}
+
+double JointError::With(const BDD &mismatch) {
+  BDD extended(manager_, Cudd_bddOr(manager_, union_.Get(), mismatch.Get()));
+  if (Cudd_ReadReorderings(manager_) != reorderings_)
+    cache_.clear();
+  ProbabilityCache cache;
+  return bdd::Probability(manager_, extended.Get(), probabilities_, cache,
+                          &cache_);
+}
+
+void JointError::Add(const BDD &mismatch) {
+  BDD extended(manager_, Cudd_bddOr(manager_, union_.Get(), mismatch.Get()));
+  if (Cudd_ReadReorderings(manager_) != reorderings_)
+    cache_.clear();
+  // The new cache only holds nodes of the new union, the old one stays valid
+  // until the old union is released
+  ProbabilityCache cache;
+  p_union_ = bdd::Probability(manager_, extended.Get(), probabilities_, cache,
+                              &cache_);
+  cache_ = std::move(cache);
+  reorderings_ = Cudd_ReadReorderings(manager_);
+  union_ = extended;
+}
+
+} // namespace bdd
+} // namespace symmetrize
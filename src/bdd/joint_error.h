@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * Contains the exact evaluation of the joint error rate of several components
+ */
+
+#include <unordered_map>
+
+#include "bdd.h"
+
+namespace symmetrize {
+namespace bdd {
+
+// Returns the BDD of all inputs on which a and b differ (a XOR b)
+BDD Mismatch(const BDD &a, const BDD &b);
+
+// Probability of the given set of inputs if input i is one with probability
+// probabilities[i] (1/2 for all inputs if not given)
+double Probability(const BDD &set, const std::vector<double> &probabilities);
+
+// Incrementally computes the probability of the union of the mismatch sets
+// of a growing set of components, i.e., the probability that any of the
+// components differs. The union BDD, its probability and the probabilities of
+// its nodes are kept, such that evaluating an additional mismatch costs one
+// disjunction and a traversal of only the nodes that are not shared with the
+// union.
+class JointError {
+
+public:
+  // Input i is one with probability probabilities[i] (1/2 if not given)
+  JointError(DdManager *manager, size_t n,
+             std::vector<double> probabilities = {});
+
+  // Probability of the union of all added mismatches
+  double Get() const { return p_union_; }
+
+  // Probability of the union of all added mismatches and the given one
+  double With(const BDD &mismatch);
+
+  // Adds the mismatch to the union
+  void Add(const BDD &mismatch);
+
+  // Probability of the given set of inputs
+  double Probability(const BDD &set) const {
+    return bdd::Probability(set, probabilities_);
+  }
+
+private:
+  DdManager *manager_;
+  std::vector<double> probabilities_;
+  BDD union_;
+  double p_union_ = 0;
+  // Probabilities of nodes of union_ (which keeps them alive), valid as long
+  // as the number of reorderings does not change
+  std::unordered_map<DdNode *, double> cache_;
+  unsigned int reorderings_ = 0;
+};
+
+} // namespace bdd
+} // namespace symmetrize
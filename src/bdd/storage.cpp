@@ -2,8 +2,12 @@
 
 #include <fstream>
 #include <limits>
+#include <stdexcept>
 #include <unordered_map>
 
+#include "../utils/hash.h"
+#include "../utils/trace.h"
+
 namespace symmetrize {
 namespace bdd {
 
@@ -60,6 +64,8 @@ static void WriteTable(EntryTable &table, std::ostream &stream) {
 }
 
 static void Write(const BDDs &bdd, std::ostream &stream) {
+  utils::Span span("bdd::Write");
+  span.Arg("roots", bdd.components.size());
   DdManager *manager = bdd.GetManager();
   int vars = manager->size;
   stream.write((const char *)&vars, sizeof(vars));
@@ -71,6 +77,7 @@ static void Write(const BDDs &bdd, std::ostream &stream) {
   EntryTable table;
   for (auto &c : bdd.components)
     GetRef(c.Get(), table);
+  span.Arg("nodes", table.size());
   WriteTable(table, stream);
   WriteSize(bdd.components.size(), stream);
   for (auto &c : bdd.components) {
@@ -129,12 +136,18 @@ static DdNode *NodeFor(DdManager *manager, Ref ref, EntryTable &table,
   DdNode *t = NodeFor(manager, entry.t, table, nodes);
   DdNode *e = NodeFor(manager, entry.e, table, nodes);
   DdNode *var = Cudd_bddIthVar(manager, entry.index);
-  return NodeFor(
-      ref,
-      nodes.emplace(ref.id, Cudd_bddIte(manager, var, t, e)).first->second);
+  DdNode *node = Cudd_bddIte(manager, var, t, e);
+  if (node == nullptr) {
+    throw std::runtime_error("reading BDD failed");
+  }
+  // Referenced until all roots are read, as a garbage collection or
+  // reordering triggered by a later ITE could free it otherwise
+  Cudd_Ref(node);
+  return NodeFor(ref, nodes.emplace(ref.id, node).first->second);
 }
 
 static bdd::BDDs Read(std::istream &stream, DdManager *manager) {
+  utils::Span span("bdd::Read");
   {
     int vars;
     stream.read((char *)&vars, sizeof(vars));
@@ -153,6 +166,7 @@ static bdd::BDDs Read(std::istream &stream, DdManager *manager) {
   EntryTable table = ReadTable(stream);
   bdd::BDDs bdd;
   Size n = ReadSize(stream);
+  span.Arg("roots", n).Arg("nodes", table.size());
   bdd.components.reserve(n);
   NodeTable nodes;
   for (Size i = 0; i < n; i++) {
@@ -161,6 +175,9 @@ static bdd::BDDs Read(std::istream &stream, DdManager *manager) {
     bdd.components.emplace_back(
         BDD(manager, NodeFor(manager, ref, table, nodes)));
   }
+  for (auto &entry : nodes) {
+    Cudd_RecursiveDeref(manager, entry.second);
+  }
   return bdd;
 }
 
@@ -178,5 +195,41 @@ bdd::BDDs Read(const std::string &filename, DdManager *manager) {
   return bdd;
 }
 
+static Size HashNode(DdNode *node, std::unordered_map<DdNode *, Size> &ids,
+                     utils::Hasher &hasher) {
+  DdNode *regular = Cudd_Regular(node);
+  Size id = IdConstant;
+  if (!Cudd_IsConstant(regular)) {
+    auto it = ids.find(regular);
+    if (it != ids.end()) {
+      id = it->second;
+    } else {
+      Size t = HashNode(Cudd_T(regular), ids, hasher);
+      Size e = HashNode(Cudd_E(regular), ids, hasher);
+      id = ids.size();
+      ids.emplace(regular, id);
+      hasher.Add(regular->index);
+      hasher.Add(t);
+      hasher.Add(e);
+    }
+  }
+  // The complement bit is stored in the lowest bit of the reference
+  return (id << 1) | Cudd_IsComplement(node);
+}
+
+uint64_t Hash(const bdd::BDDs &bdd) {
+  utils::Hasher hasher;
+  DdManager *manager = bdd.GetManager();
+  hasher.Add(manager->size);
+  for (int i = 0; i < manager->size; i++) {
+    hasher.Add(Cudd_ReadInvPerm(manager, i));
+  }
+  std::unordered_map<DdNode *, Size> ids;
+  for (auto &c : bdd.components) {
+    hasher.Add(HashNode(c.Get(), ids, hasher));
+  }
+  return hasher.Get();
+}
+
 } // namespace bdd
 } // namespace symmetrize
@@ -13,5 +13,10 @@ void Write(const bdd::BDDs &bdd, const std::string &filename);
 bdd::BDDs Read(std::istream &stream, DdManager *manager = nullptr);
 bdd::BDDs Read(const std::string &filename, DdManager *manager = nullptr);
 
+// Hashes the variable order and the structure of the BDDs. Nodes are numbered
+// in the order of a depth-first traversal, so the hash does not depend on
+// their addresses.
+uint64_t Hash(const bdd::BDDs &bdd);
+
 } // namespace bdd
 } // namespace symmetrize
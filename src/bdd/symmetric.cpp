@@ -1,5 +1,12 @@
 #include "symmetric.h"
 
+#include <memory>
+
+#include <bdd/extrab/extraBdd.h>
+
+#include "../utils/maths.h"
+#include "../utils/trace.h"
+
 namespace symmetrize {
 namespace bdd {
 
@@ -12,7 +19,9 @@ class MMatrix {
 
 public:
   MMatrix(DdManager *mgr, int n);
-  MMatrix(DdManager *mgr, std::vector<int> vars);
+  // The literal of vars[i] is complemented if inverted[i] is set
+  MMatrix(DdManager *mgr, std::vector<int> vars,
+          const std::vector<bool> &inverted = {});
   ~MMatrix() { clear(); }
 
   void clear() {
@@ -39,7 +48,8 @@ static std::vector<int> Range(int n) {
 
 MMatrix::MMatrix(DdManager *mgr, int n) : MMatrix(mgr, Range(n)) {}
 
-MMatrix::MMatrix(DdManager *mgr, std::vector<int> vars)
+MMatrix::MMatrix(DdManager *mgr, std::vector<int> vars,
+                 const std::vector<bool> &inverted)
     : mgr(mgr), width(vars.size() + 2), m(width * (vars.size() + 1)) {
   MMatrix &M = *this;
   size_t n = vars.size();
@@ -60,8 +70,10 @@ MMatrix::MMatrix(DdManager *mgr, std::vector<int> vars)
   }
   for (size_t i = 1; i <= n; i++) {
     for (size_t j = 1; j <= i + 1; j++) {
-      DdNode *node = Cudd_bddIte(mgr, Cudd_bddIthVar(mgr, vars[i - 1]),
-                                 M[i - 1][j - 1], M[i - 1][j]);
+      DdNode *var = Cudd_bddIthVar(mgr, vars[i - 1]);
+      if (!inverted.empty() && inverted[i - 1])
+        var = Cudd_Not(var);
+      DdNode *node = Cudd_bddIte(mgr, var, M[i - 1][j - 1], M[i - 1][j]);
       Cudd_Ref(node);
       M[i][j] = node;
     }
@@ -86,15 +98,95 @@ static DdNode *ValueVectorToBDD(DdManager *mgr, const ValueVector &vector,
 }
 
 BDDs Create(DdManager *manager, const SymmetricFunction &f) {
+  utils::Span span("bdd::Create");
+  span.Arg("components", f.components.size()).Arg("n", f.n);
   size_t m = f.components.size();
   std::vector<BDD> bdds;
   bdds.reserve(m);
-  MMatrix M(manager, f.n);
+  MMatrix M(manager, Range(f.n), f.inverted_inputs);
   for (auto &component : f.components) {
     bdds.emplace_back(manager, ValueVectorToBDD(manager, component, M));
   }
   return {bdds};
 }
 
+// Builds the BDD for the entries offset + w_j * strides[j] + ... of vector
+// where only the blocks 0, ..., j are free. Ms[j] is the matrix of block j.
+static DdNode *BlockVectorToBDD(DdManager *mgr, const ValueVector &vector,
+                                const InputBlocks &blocks,
+                                std::vector<std::unique_ptr<MMatrix>> &Ms,
+                                const std::vector<size_t> &strides, int j,
+                                size_t offset) {
+  if (j < 0) {
+    DdNode *res = vector[offset] ? Cudd_ReadOne(mgr) : Cudd_ReadLogicZero(mgr);
+    Cudd_Ref(res);
+    return res;
+  }
+  size_t n_j = blocks[j].size();
+  MMatrix &M = *Ms[j];
+  DdNode *res = Cudd_ReadLogicZero(mgr);
+  Cudd_Ref(res);
+  for (size_t w = 0; w <= n_j; w++) {
+    DdNode *sub = BlockVectorToBDD(mgr, vector, blocks, Ms, strides, j - 1,
+                                   offset + w * strides[j]);
+    DdNode *term = Cudd_bddAnd(mgr, M[n_j][w + 1], sub);
+    Cudd_Ref(term);
+    Cudd_RecursiveDeref(mgr, sub);
+    DdNode *new_res = Cudd_bddOr(mgr, res, term);
+    Cudd_Ref(new_res);
+    Cudd_RecursiveDeref(mgr, term);
+    Cudd_RecursiveDeref(mgr, res);
+    res = new_res;
+  }
+  return res;
+}
+
+BDDs Create(DdManager *manager, const BlockSymmetricFunction &f) {
+  utils::Span span("bdd::Create blocks");
+  span.Arg("components", f.components.size()).Arg("blocks", f.blocks.size());
+  std::vector<std::unique_ptr<MMatrix>> Ms;
+  for (auto &block : f.blocks) {
+    Ms.push_back(std::make_unique<MMatrix>(manager, block));
+  }
+  auto strides = MixedRadixStrides(BlockRadices(f.blocks));
+  std::vector<BDD> bdds;
+  bdds.reserve(f.components.size());
+  for (auto &component : f.components) {
+    DdNode *node = BlockVectorToBDD(manager, component, f.blocks, Ms, strides,
+                                    (int)f.blocks.size() - 1, 0);
+    Cudd_Deref(node);
+    bdds.emplace_back(manager, node);
+  }
+  return {bdds};
+}
+
+bool IsSymmetric(const BDD &f, size_t n) {
+  DdNode *node = f.Get();
+  if (Cudd_IsConstant(node))
+    return true;
+  for (size_t i = 0; i + 1 < n; i++) {
+    if (!Extra_bddCheckVarsSymmetric(f.GetManager(), node, i, i + 1))
+      return false;
+  }
+  return true;
+}
+
+ValueVector ValueVectorOf(const BDD &f, size_t n) {
+  ValueVector vector(n + 1);
+  for (size_t w = 0; w <= n; w++) {
+    // Follow the path of the input assigning 1 to exactly the variables < w
+    DdNode *node = f.Get();
+    bool complemented = false;
+    while (!Cudd_IsConstant(node)) {
+      complemented ^= Cudd_IsComplement(node);
+      node = Cudd_Regular(node);
+      node = Cudd_NodeReadIndex(node) < w ? Cudd_T(node) : Cudd_E(node);
+    }
+    complemented ^= Cudd_IsComplement(node);
+    vector[w] = !complemented;
+  }
+  return vector;
+}
+
 } // namespace bdd
 } // namespace symmetrize
@@ -12,5 +12,16 @@ namespace bdd {
 // 1 Jan. 2022, doi: 10.1109/TC.2020.3043476.
 BDDs Create(DdManager *mgr, const SymmetricFunction &f);
 
+// Creates the BDDs for the given block symmetric function
+BDDs Create(DdManager *mgr, const BlockSymmetricFunction &f);
+
+// Returns true iff f is constant or symmetric in all n variables, which is
+// checked on the pairs of variables with adjacent indices
+bool IsSymmetric(const BDD &f, size_t n);
+
+// Returns the value vector of the symmetric function f over n variables,
+// i.e., the value of f for the inputs 1^w 0^(n-w) for w = 0, ..., n
+ValueVector ValueVectorOf(const BDD &f, size_t n);
+
 } // namespace bdd
 } // namespace symmetrize
@@ -0,0 +1,175 @@
+#include "word.h"
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include "ch.h"
+#include "joint_error.h"
+#include "symmetric.h"
+
+#include "../utils/trace.h"
+
+namespace symmetrize {
+namespace bdd {
+
+using Word = uint64_t;
+
+static BDD And(const BDD &a, const BDD &b) {
+  return {a.GetManager(), Cudd_bddAnd(a.GetManager(), a.Get(), b.Get())};
+}
+
+static BDD Or(const BDD &a, const BDD &b) {
+  return {a.GetManager(), Cudd_bddOr(a.GetManager(), a.Get(), b.Get())};
+}
+
+static BDD Not(const BDD &a) { return {a.GetManager(), Cudd_Not(a.Get())}; }
+
+// Symmetric function whose component i in class k is bit i of words[k]
+static SymmetricFunction ToFunction(const std::vector<Word> &words, size_t n,
+                                    size_t m) {
+  SymmetricFunction f = {.n = n, .m = m};
+  f.components.assign(m, ValueVector(n + 1));
+  f.hamming_distances.assign(m, 0);
+  for (size_t i = 0; i < m; i++) {
+    for (size_t k = 0; k <= n; k++) {
+      f.components[i][k] = (words[k] >> i) & 1;
+    }
+  }
+  return f;
+}
+
+// Returns the BDD of all inputs x with sum_{i >= j} 2^i f_i(x) >= t(x), where
+// t is given by the bits of a symmetric function whose bits below j are zero
+static BDD AtLeast(const BDDs &f, const BDDs &t, size_t j) {
+  DdManager *mgr = f.GetManager();
+  BDD gt(mgr, Cudd_ReadLogicZero(mgr));
+  BDD eq(mgr, Cudd_ReadOne(mgr));
+  for (size_t i = f.components.size(); i-- > j;) {
+    auto &x_i = f.components[i];
+    auto &t_i = t.components[i];
+    gt = Or(gt, And(eq, And(x_i, Not(t_i))));
+    eq = And(eq, Not(Mismatch(x_i, t_i)));
+  }
+  return Or(gt, eq);
+}
+
+static std::vector<Word> Medians(const BDDs &f, size_t n,
+                                 const InputBlocks &all,
+                                 const std::vector<double> &probabilities,
+                                 const ValueCountsHW &totals) {
+  size_t m = f.components.size();
+  std::vector<Word> medians(n + 1, 0);
+  for (size_t j = m; j-- > 0;) {
+    std::vector<Word> thresholds = medians;
+    for (auto &t : thresholds) {
+      t |= Word(1) << j;
+    }
+    auto t = Create(f.GetManager(), ToFunction(thresholds, n, m));
+    auto at_least = AtLeast(f, t, j);
+    auto counts = C_H(BDDs{{at_least}}, n, all, probabilities)[0];
+    for (size_t k = 0; k <= n; k++) {
+      // Largest word such that at least half of the class is not below it
+      if (totals[k] > 0 && 2 * counts[k] >= totals[k])
+        medians[k] = thresholds[k];
+    }
+  }
+  return medians;
+}
+
+static std::vector<Word> Means(const std::vector<ValueCountsHW> &Ts, size_t n,
+                               const ValueCountsHW &totals) {
+  size_t m = Ts.size();
+  double max = exp2(m) - 1;
+  std::vector<Word> means(n + 1, 0);
+  for (size_t k = 0; k <= n; k++) {
+    if (totals[k] <= 0)
+      continue;
+    double sum = 0;
+    for (size_t i = 0; i < m; i++) {
+      sum += exp2(i) * Ts[i][k];
+    }
+    means[k] = (Word)std::min(max, std::round(sum / totals[k]));
+  }
+  return means;
+}
+
+SymmetricFunction WordSymmetricFunction(const BDDs &f, size_t n,
+                                        const std::vector<double> &probabilities,
+                                        WordErrorMetric metric) {
+  utils::Span span("WordSymmetricFunction");
+  size_t m = f.components.size();
+  span.Arg("components", m).Arg("n", n);
+  if (m >= 64) {
+    throw std::invalid_argument("output words are limited to 63 bits");
+  }
+  InputBlocks all(1);
+  for (size_t i = 0; i < n; i++) {
+    all[0].push_back(i);
+  }
+  auto Ts = C_H(f, n, all, probabilities);
+  auto totals = BlockTotals(all, probabilities);
+
+  auto words = metric == WordErrorMetric::MSE
+                   ? Means(Ts, n, totals)
+                   : Medians(f, n, all, probabilities, totals);
+  auto res = ToFunction(words, n, m);
+  for (size_t i = 0; i < m; i++) {
+    for (size_t k = 0; k <= n; k++) {
+      res.hamming_distances[i] +=
+          res.components[i][k] ? totals[k] - Ts[i][k] : Ts[i][k];
+    }
+  }
+  return res;
+}
+
+double WordError(const BDDs &f, const BDDs &f_hat,
+                 const std::vector<double> &probabilities,
+                 WordErrorMetric metric) {
+  size_t m = f.components.size();
+  if (f_hat.components.size() != m) {
+    throw std::invalid_argument("different m for other BDD");
+  }
+  if (m == 0)
+    return 0;
+  DdManager *mgr = f.GetManager();
+
+  // Bits of d = f - f_hat and the borrow, which is the sign of d
+  std::vector<BDD> d(m);
+  BDD borrow(mgr, Cudd_ReadLogicZero(mgr));
+  for (size_t i = 0; i < m; i++) {
+    auto &x = f.components[i];
+    auto &y = f_hat.components[i];
+    auto x_xor_y = Mismatch(x, y);
+    d[i] = Mismatch(x_xor_y, borrow);
+    borrow = Or(And(Not(x), y), And(Not(x_xor_y), borrow));
+  }
+
+  // |d| by negating d if it is negative: bits above the lowest one are
+  // inverted
+  std::vector<BDD> abs(m);
+  BDD lower_one(mgr, Cudd_ReadLogicZero(mgr));
+  for (size_t i = 0; i < m; i++) {
+    abs[i] = Mismatch(d[i], And(borrow, lower_one));
+    lower_one = Or(lower_one, d[i]);
+  }
+
+  double error = 0;
+  if (metric == WordErrorMetric::MAE) {
+    for (size_t i = 0; i < m; i++) {
+      error += exp2(i) * Probability(abs[i], probabilities);
+    }
+    return error;
+  }
+  // E[|d|^2] = sum_{i, j} 2^(i + j) P(|d|_i and |d|_j)
+  for (size_t i = 0; i < m; i++) {
+    error += exp2(2 * i) * Probability(abs[i], probabilities);
+    for (size_t j = i + 1; j < m; j++) {
+      error += 2 * exp2(i + j) * Probability(And(abs[i], abs[j]), probabilities);
+    }
+  }
+  return error;
+}
+
+} // namespace bdd
+} // namespace symmetrize
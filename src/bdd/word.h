@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * Contains the symmetrization of the output word as a whole, i.e., of the
+ * integer sum_i 2^i f_i(x), with respect to its numeric error
+ */
+
+#include "bdd.h"
+
+namespace symmetrize {
+namespace bdd {
+
+enum class WordErrorMetric {
+  MAE, // mean absolute error
+  MSE  // mean squared error
+};
+
+// Calculates the symmetric function whose output word minimizes the numeric
+// error to that of f. For every Hamming weight class, this is the median
+// (MAE) or the rounded mean (MSE) of the output words in the class. The
+// means follow from the C_H tables of the bits, the medians are determined
+// bit by bit, starting with the MSB, by counting the inputs whose output word
+// is at least the current threshold.
+//
+// Input i is one with probability probabilities[i] (uniform if not given).
+// The Hamming distances are scaled like those of C_H.
+SymmetricFunction WordSymmetricFunction(const BDDs &f, size_t n,
+                                        const std::vector<double> &probabilities,
+                                        WordErrorMetric metric);
+
+// Calculates the mean absolute or squared numeric error between the output
+// words of f and f_hat under the given input probabilities
+double WordError(const BDDs &f, const BDDs &f_hat,
+                 const std::vector<double> &probabilities,
+                 WordErrorMetric metric);
+
+} // namespace bdd
+} // namespace symmetrize
@@ -0,0 +1,197 @@
+#include "checkpoint.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace symmetrize {
+
+static const char *MANIFEST = "manifest";
+static const char *FUNCTIONS = "symm";
+static const char *AIG = "aig.aig";
+static const char *PROFITS = "profits";
+
+// Writes the file via a temporary file, so that it only exists once complete
+static void WriteFile(const std::string &path,
+                      const std::function<void(std::ostream &)> &write) {
+  {
+    std::ofstream out(path + ".part");
+    if (!out) {
+      throw std::runtime_error("could not write " + path);
+    }
+    out.precision(std::numeric_limits<double>::max_digits10);
+    write(out);
+    if (!out) {
+      throw std::runtime_error("could not write " + path);
+    }
+  }
+  std::filesystem::rename(path + ".part", path);
+}
+
+static std::ifstream OpenFile(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("could not open " + path);
+  }
+  in.exceptions(std::ios::badbit | std::ios::failbit);
+  return in;
+}
+
+template <typename T>
+static void WriteVector(std::ostream &out, const std::vector<T> &v) {
+  out << v.size();
+  for (const auto &x : v) {
+    out << " " << x;
+  }
+  out << "\n";
+}
+
+template <typename T> static std::vector<T> ReadVector(std::istream &in) {
+  size_t size;
+  in >> size;
+  std::vector<T> v(size);
+  for (size_t i = 0; i < size; i++) {
+    T x;
+    in >> x;
+    v[i] = x;
+  }
+  return v;
+}
+
+static void WriteVectors(std::ostream &out,
+                         const std::vector<ValueVector> &vs) {
+  out << vs.size() << "\n";
+  for (auto &v : vs) {
+    WriteVector(out, v);
+  }
+}
+
+static std::vector<ValueVector> ReadVectors(std::istream &in) {
+  size_t size;
+  in >> size;
+  std::vector<ValueVector> vs(size);
+  for (auto &v : vs) {
+    v = ReadVector<TruthValue>(in);
+  }
+  return vs;
+}
+
+Checkpoint::Checkpoint(const std::string &directory, bool resume,
+                       uint64_t network_hash, uint64_t bdd_hash,
+                       const std::string &settings)
+    : directory_(directory) {
+  std::ostringstream manifest;
+  manifest << "network " << network_hash << "\nbdd " << bdd_hash
+           << "\nsettings " << settings << "\n";
+  if (resume) {
+    auto in = OpenFile(Path(MANIFEST));
+    std::stringstream stored;
+    stored << in.rdbuf();
+    if (stored.str() != manifest.str()) {
+      throw std::invalid_argument(
+          "checkpoint in " + directory +
+          " belongs to a different network, BDD or settings");
+    }
+    return;
+  }
+  std::filesystem::create_directories(directory);
+  for (auto name : {MANIFEST, FUNCTIONS, AIG, PROFITS}) {
+    std::filesystem::remove(Path(name));
+  }
+  WriteFile(Path(MANIFEST),
+            [&](std::ostream &out) { out << manifest.str(); });
+}
+
+std::string Checkpoint::Path(const std::string &name) const {
+  return directory_ + "/" + name;
+}
+
+bool Checkpoint::HasFunctions() const {
+  return std::filesystem::exists(Path(FUNCTIONS));
+}
+
+void Checkpoint::SaveFunctions(const SymmetricFunction &f_tilde,
+                               const BlockSymmetricFunction &f_block) const {
+  WriteFile(Path(FUNCTIONS), [&](std::ostream &out) {
+    out << f_tilde.n << " " << f_tilde.m << "\n";
+    WriteVectors(out, f_tilde.components);
+    WriteVector(out, f_tilde.hamming_distances);
+    WriteVector(out, f_tilde.inverted_inputs);
+    out << f_block.n << " " << f_block.m << "\n" << f_block.blocks.size()
+        << "\n";
+    for (auto &block : f_block.blocks) {
+      WriteVector(out, block);
+    }
+    WriteVectors(out, f_block.components);
+    WriteVector(out, f_block.hamming_distances);
+  });
+}
+
+void Checkpoint::LoadFunctions(SymmetricFunction &f_tilde,
+                               BlockSymmetricFunction &f_block) const {
+  auto in = OpenFile(Path(FUNCTIONS));
+  in >> f_tilde.n >> f_tilde.m;
+  f_tilde.components = ReadVectors(in);
+  f_tilde.hamming_distances = ReadVector<ValueCount>(in);
+  f_tilde.inverted_inputs = ReadVector<bool>(in);
+  size_t k;
+  in >> f_block.n >> f_block.m >> k;
+  f_block.blocks.resize(k);
+  for (auto &block : f_block.blocks) {
+    block = ReadVector<int>(in);
+  }
+  f_block.components = ReadVectors(in);
+  f_block.hamming_distances = ReadVector<ValueCount>(in);
+}
+
+bool Checkpoint::HasAIG() const { return std::filesystem::exists(Path(AIG)); }
+
+// The AIGER functions are called directly instead of the read and write
+// commands, which would split paths containing spaces
+void Checkpoint::SaveAIG(Abc_Frame_t *frame) const {
+  Abc_Ntk_t *ntk = Abc_FrameReadNtk(frame);
+  std::string part = Path(AIG) + ".part";
+  std::filesystem::remove(part);
+  if (ntk == nullptr || !Abc_NtkIsStrash(ntk)) {
+    throw std::runtime_error("writing AIG checkpoint failed");
+  }
+  Io_WriteAiger(ntk, &part[0], 1, 0, 0);
+  if (!std::filesystem::exists(part)) {
+    throw std::runtime_error("writing AIG checkpoint failed");
+  }
+  std::filesystem::rename(part, Path(AIG));
+}
+
+Abc_Ntk_t *Checkpoint::LoadAIG(Abc_Frame_t *frame) const {
+  std::string path = Path(AIG);
+  Abc_Ntk_t *ntk = Io_Read(&path[0], IO_FILE_AIGER, 1, 0);
+  if (ntk == nullptr) {
+    throw std::runtime_error("reading AIG checkpoint failed");
+  }
+  Abc_FrameReplaceCurrentNetwork(frame, ntk);
+  return ntk;
+}
+
+bool Checkpoint::HasProfits() const {
+  return std::filesystem::exists(Path(PROFITS));
+}
+
+void Checkpoint::SaveProfits(const std::vector<Profit> &full,
+                             const std::vector<Profit> &block) const {
+  WriteFile(Path(PROFITS), [&](std::ostream &out) {
+    WriteVector(out, full);
+    WriteVector(out, block);
+  });
+}
+
+void Checkpoint::LoadProfits(std::vector<Profit> &full,
+                             std::vector<Profit> &block) const {
+  auto in = OpenFile(Path(PROFITS));
+  full = ReadVector<Profit>(in);
+  block = ReadVector<Profit>(in);
+}
+
+} // namespace symmetrize
@@ -0,0 +1,56 @@
+#pragma once
+
+/*
+ * Contains checkpoints for resuming long symmetrization runs
+ */
+
+#include <string>
+#include <vector>
+
+#include "componentwise.h"
+#include "includes.h"
+
+namespace symmetrize {
+
+// Directory holding the results of the completed phases of a symmetrization
+// run:
+//   manifest  hashes of the input network and its global BDDs and the
+//             settings of the run
+//   symm      value vectors and Hamming distances of f_tilde and f_block
+//   aig.aig   the (optimized) AIG including the POs of all candidates
+//   profits   profits of the evaluated candidates
+// Each file is written to a temporary file that is renamed afterwards, hence
+// only the files of completed phases exist. Phases that ran degraded because
+// of the budget are not saved.
+class Checkpoint {
+public:
+  // Starts a new checkpoint in directory, removing the results of earlier
+  // runs. If resume is set, the existing checkpoint is kept instead, but it
+  // has to belong to the same network, BDDs and settings.
+  Checkpoint(const std::string &directory, bool resume, uint64_t network_hash,
+             uint64_t bdd_hash, const std::string &settings);
+
+  bool HasFunctions() const;
+  void SaveFunctions(const SymmetricFunction &f_tilde,
+                     const BlockSymmetricFunction &f_block) const;
+  void LoadFunctions(SymmetricFunction &f_tilde,
+                     BlockSymmetricFunction &f_block) const;
+
+  // Writes the current network of frame or replaces it by the stored one
+  bool HasAIG() const;
+  void SaveAIG(Abc_Frame_t *frame) const;
+  Abc_Ntk_t *LoadAIG(Abc_Frame_t *frame) const;
+
+  bool HasProfits() const;
+  void SaveProfits(const std::vector<Profit> &full,
+                   const std::vector<Profit> &block) const;
+  void LoadProfits(std::vector<Profit> &full,
+                   std::vector<Profit> &block) const;
+
+private:
+  std::string Path(const std::string &name) const;
+
+  std::string directory_;
+};
+
+} // namespace symmetrize
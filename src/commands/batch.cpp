@@ -0,0 +1,390 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../aig/network.h"
+#include "../bdd/storage.h"
+#include "../componentwise.h"
+#include "../utils/process.h"
+#include "common.h"
+
+namespace symmetrize {
+namespace commands {
+
+static const char *USAGE_SYMMETRIZE_BATCH =
+    "symmetrize_batch [-j workers] [-t timeout] [-o output file] "
+    "[-c optimization command] [-P profits] [-U unbounded error] [-v] "
+    "[error: er/awae/nawae] [error bound] [directory/manifest]\n"
+    "  symmetrizes every preprocessed network (pair of .aig and .bdd files)\n"
+    "  of the directory or listed in the manifest (one path per line,\n"
+    "  without extension) with each profit metric, once with the unbounded\n"
+    "  and once with the given error bound, in forked workers\n"
+    "  -j: number of workers (default: 1); with more, the timings are\n"
+    "      measured under contention\n"
+    "  -t: timeout in seconds per network and configuration\n"
+    "  -o: CSV file, or JSON file if ending with .json (default:\n"
+    "      benchmark/compwise/<directory>/<time>_<directory>_<error>_\n"
+    "      <bound>.csv)\n"
+    "  -c: optimization command (default: runsc resyn2)\n"
+    "  -P: comma separated profit metrics (default: const,bdd,aig)\n"
+    "  -U: error bound of the unbounded runs (default: 100)\n"
+    "  -v: do not discard the output of the workers\n";
+
+// Columns of each configuration, which are preceded by the columns describing
+// the network
+static const std::vector<std::string> CONFIG_COLUMNS = {
+    "t_select", "selection", "n_bdd", "n_bdd_gain", "n_aig", "n_aig_gain",
+    "err"};
+static const std::vector<std::string> NETWORK_COLUMNS = {
+    "pi", "po", "n_bdd", "n_aig", "t_symm", "t_aig", "t_bdd"};
+
+struct SymmetrizeBatchParameters {
+  std::string error_metric, error_bound;
+  std::string unbounded = "100";
+  std::vector<std::string> profits = {"const", "bdd", "aig"};
+  std::string optimization_command = "runsc resyn2";
+  bool verbose = false;
+};
+
+struct SymmetrizeBatchJob {
+  // Path of the network without extension
+  std::string base;
+  std::string error_bound, profit;
+};
+
+static std::string Now(const char *format) {
+  char txt[64];
+  std::time_t now = std::time(nullptr);
+  std::strftime(txt, sizeof(txt), format, std::localtime(&now));
+  return txt;
+}
+
+static std::string Format(double value, int precision = 2) {
+  char txt[64];
+  snprintf(txt, sizeof(txt), "%.*f", precision, value);
+  return txt;
+}
+
+static std::string Gain(size_t before, size_t after) {
+  return Format(100.0 * ((double)before - after) / before) + "%";
+}
+
+// Returns the paths without extension of the networks in the directory or
+// manifest
+static std::vector<std::string> ListNetworks(const std::string &path) {
+  std::vector<std::string> bases;
+  if (std::filesystem::is_directory(path)) {
+    for (auto &entry : std::filesystem::directory_iterator(path)) {
+      auto file = entry.path();
+      if (file.extension() == ".aig" &&
+          std::filesystem::exists(file.replace_extension(".bdd"))) {
+        bases.push_back(file.replace_extension("").string());
+      }
+    }
+    std::sort(bases.begin(), bases.end());
+    return bases;
+  }
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("could not open " + path);
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    while (!line.empty() && isspace(line.back()))
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    if (line.size() > 4 && line.compare(line.size() - 4, 4, ".aig") == 0)
+      line.resize(line.size() - 4);
+    bases.push_back(line);
+  }
+  return bases;
+}
+
+// Loads the network and its global BDDs into frame, like read and gbdd_load.
+// Io_Read is called directly, as the read command would split paths
+// containing spaces.
+static Abc_Ntk_t *LoadNetwork(Abc_Frame_t *frame, const std::string &base) {
+  std::string path = base + ".aig";
+  Abc_Ntk_t *ntk = Io_Read(&path[0], IO_FILE_AIGER, 1, 0);
+  if (ntk == nullptr) {
+    throw std::runtime_error("reading " + path + " failed");
+  }
+  Abc_FrameReplaceCurrentNetwork(frame, ntk);
+  bdd::BDDs bdd = bdd::Read(base + ".bdd");
+  if (bdd.components.size() != (size_t)Abc_NtkCoNum(ntk)) {
+    DdManager *manager = bdd.GetManager();
+    bdd.components = {};
+    Cudd_Quit(manager);
+    throw std::runtime_error("wrong number of roots in " + base + ".bdd");
+  }
+  aig::SetGlobalBDDs(ntk, bdd);
+  return ntk;
+}
+
+// Runs within the worker; returns the start time followed by the network
+// and configuration columns
+static std::string SymmetrizeJob(Abc_Frame_t *frame,
+                                 const SymmetrizeBatchParameters &p,
+                                 const SymmetrizeBatchJob &job) {
+  std::string time = Now("%H:%M:%S %d.%m.%Y");
+  if (!p.verbose) {
+    fflush(stdout);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+      dup2(null_fd, STDOUT_FILENO);
+      close(null_fd);
+    }
+  }
+
+  ComponentwiseSymmetrizationParameters param;
+  param.frame = frame;
+  param.ntk = LoadNetwork(frame, job.base);
+  param.factors = WAEFactors::BY_NAME.at(p.error_metric);
+  ToDouble(job.error_bound.c_str(), param.error_bound);
+  param.profit_metric = ProfitMetrics::BY_NAME.at(job.profit);
+  param.optimization_command = p.optimization_command;
+  size_t n_pi = Abc_NtkPiNum(param.ntk), n_po = Abc_NtkPoNum(param.ntk);
+
+  auto r = Symmetrize(param);
+  std::vector<std::string> fields = {
+      time,
+      std::to_string(n_pi),
+      std::to_string(n_po),
+      std::to_string(r.bdd_size_before),
+      std::to_string(r.aig_size_before),
+      Format(r.t_symm),
+      Format(r.t_aig),
+      Format(r.t_bdd),
+      Format(r.t_select),
+      r.selection,
+      std::to_string(r.bdd_size_after),
+      Gain(r.bdd_size_before, r.bdd_size_after),
+      std::to_string(r.aig_size_after),
+      Gain(r.aig_size_before, r.aig_size_after),
+      Format(r.error)};
+  std::string output;
+  for (auto &field : fields) {
+    output += (output.empty() ? "" : ";") + field;
+  }
+  return output;
+}
+
+static std::string StatusString(utils::ForkedResult::Status status) {
+  switch (status) {
+  case utils::ForkedResult::Status::SUCCESS:
+    return "done";
+  case utils::ForkedResult::Status::TIMEOUT:
+    return "timeout";
+  default:
+    return "failed";
+  }
+}
+
+static void WriteCSV(const std::vector<std::string> &header,
+                     const std::vector<std::vector<std::string>> &rows,
+                     const std::string &filename) {
+  std::ofstream out(filename);
+  for (auto &column : header) {
+    out << column << ";";
+  }
+  out << "\n";
+  for (auto &row : rows) {
+    for (auto &field : row) {
+      out << field << ";";
+    }
+    out << "\n";
+  }
+}
+
+// Writes "-" as null, the selections and other non-numeric fields as strings
+// and everything else as numbers
+static void WriteJSON(const std::vector<std::string> &header,
+                      const std::vector<std::vector<std::string>> &rows,
+                      const std::string &filename) {
+  std::ofstream out(filename);
+  out << "[\n";
+  for (size_t i = 0; i < rows.size(); i++) {
+    out << "  {";
+    for (size_t j = 0; j < header.size(); j++) {
+      auto &field = rows[i][j];
+      char *end;
+      bool numeric = !field.empty() &&
+                     (strtod(field.c_str(), &end), *end == '\0');
+      bool selection = header[j].size() >= 9 &&
+                       header[j].compare(header[j].size() - 9, 9,
+                                         "selection") == 0;
+      out << (j ? ", " : "") << "\"" << header[j] << "\": ";
+      if (field == "-") {
+        out << "null";
+      } else if (numeric && !selection) {
+        out << field;
+      } else {
+        out << "\"" << field << "\"";
+      }
+    }
+    out << "}" << (i + 1 < rows.size() ? "," : "") << "\n";
+  }
+  out << "]\n";
+}
+
+// symmetrize_batch [-j workers] [-t timeout] [-o output file]
+//                  [-c optimization command] [-P profits] [-U unbounded]
+//                  [-v] [error: er/awae/nawae] [error bound]
+//                  [directory/manifest]
+int CommandSymmetrizeBatch(Abc_Frame_t *frame, int argc, char **argv) {
+  SymmetrizeBatchParameters p;
+  size_t workers = 1;
+  double timeout = 0, value;
+  std::string output_file;
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "jtocPUvh")) != EOF) {
+    const char *arg;
+    bool valid = c != 'h' && (c == 'v' || NextArg(argc, argv, arg));
+    if (valid && c == 'v') {
+      p.verbose = true;
+    } else if (valid && c == 'j') {
+      valid = ToSize(arg, workers) && workers > 0;
+    } else if (valid && c == 't') {
+      valid = ToDouble(arg, timeout);
+    } else if (valid && c == 'o') {
+      output_file = arg;
+    } else if (valid && c == 'c') {
+      p.optimization_command = arg;
+    } else if (valid && c == 'P') {
+      p.profits = Split(arg, ',');
+      for (auto &profit : p.profits) {
+        valid = valid && ProfitMetrics::BY_NAME.count(profit);
+      }
+    } else if (valid && c == 'U') {
+      p.unbounded = arg;
+      valid = ToDouble(arg, value);
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      Abc_Print(ABC_ERROR, USAGE_SYMMETRIZE_BATCH);
+      return 1;
+    }
+  }
+  if (argc - globalUtilOptind != 3 ||
+      !WAEFactors::BY_NAME.count(argv[globalUtilOptind]) ||
+      !ToDouble(argv[globalUtilOptind + 1], value)) {
+    Abc_Print(ABC_ERROR, USAGE_SYMMETRIZE_BATCH);
+    return 1;
+  }
+  p.error_metric = argv[globalUtilOptind];
+  p.error_bound = argv[globalUtilOptind + 1];
+  std::string input = argv[globalUtilOptind + 2];
+
+  auto bases = ListNetworks(input);
+  if (output_file.empty()) {
+    // Named after the directory like bench_compwise.py does
+    std::string category = "batch";
+    if (std::filesystem::is_directory(input)) {
+      auto path = std::filesystem::path(input).lexically_normal();
+      category = (path.has_filename() ? path : path.parent_path())
+                     .filename()
+                     .string();
+    }
+    std::string directory = "benchmark/compwise/" + category;
+    std::filesystem::create_directories(directory);
+    output_file = directory + "/" + Now("%Y_%m_%d_%H_%M_%S") + "_" +
+                  category + "_" + p.error_metric + "_" + p.error_bound +
+                  ".csv";
+  }
+
+  // Unbounded runs first, each with every profit metric
+  std::vector<std::pair<std::string, std::string>> configs;
+  for (auto *bound : {&p.unbounded, &p.error_bound}) {
+    for (auto &profit : p.profits) {
+      configs.emplace_back(*bound, profit);
+    }
+  }
+  std::vector<SymmetrizeBatchJob> jobs;
+  for (auto &base : bases) {
+    for (auto &config : configs) {
+      jobs.push_back({base, config.first, config.second});
+    }
+  }
+  Abc_Print(ABC_STANDARD,
+            "Symmetrizing %zu networks in %zu configurations\n", bases.size(),
+            configs.size());
+
+  std::string start = Now("%H:%M:%S %d.%m.%Y");
+  size_t finished = 0;
+  auto results = utils::RunForked(
+      jobs.size(), workers,
+      [&](size_t i) { return SymmetrizeJob(frame, p, jobs[i]); }, timeout,
+      [&](size_t i, const utils::ForkedResult &result) {
+        Abc_Print(ABC_STANDARD, "[%zu/%zu] %s %s %s: %s (%.2f sec)\n",
+                  ++finished, jobs.size(),
+                  std::filesystem::path(jobs[i].base).filename().c_str(),
+                  jobs[i].profit.c_str(), jobs[i].error_bound.c_str(),
+                  StatusString(result.status).c_str(), result.seconds);
+      });
+
+  std::vector<std::string> header = {"time", "name", "error_metric",
+                                     "threshold"};
+  header.insert(header.end(), NETWORK_COLUMNS.begin(), NETWORK_COLUMNS.end());
+  for (size_t k = 0; k < configs.size(); k++) {
+    std::string prefix = (k < p.profits.size() ? "ub_" : "b_") +
+                         configs[k].second + "_";
+    for (auto &column : CONFIG_COLUMNS) {
+      header.push_back(prefix + column);
+    }
+  }
+
+  // The network columns are taken from the first successful configuration
+  std::vector<std::vector<std::string>> rows;
+  int failed = 0;
+  for (size_t i = 0; i < bases.size(); i++) {
+    std::vector<std::string> network(1 + NETWORK_COLUMNS.size(), "-");
+    network[0] = start;
+    std::vector<std::string> config_fields;
+    bool found = false;
+    for (size_t k = 0; k < configs.size(); k++) {
+      auto &result = results[i * configs.size() + k];
+      if (result.status != utils::ForkedResult::Status::SUCCESS) {
+        config_fields.insert(config_fields.end(), CONFIG_COLUMNS.size(), "-");
+        failed++;
+        continue;
+      }
+      auto fields = Split(result.output, ';');
+      if (!found) {
+        network.assign(fields.begin(), fields.begin() + network.size());
+        found = true;
+      }
+      config_fields.insert(config_fields.end(), fields.begin() + network.size(),
+                           fields.end());
+    }
+    std::vector<std::string> row = {
+        network[0], std::filesystem::path(bases[i]).filename().string(),
+        p.error_metric, p.error_bound};
+    row.insert(row.end(), network.begin() + 1, network.end());
+    row.insert(row.end(), config_fields.begin(), config_fields.end());
+    rows.push_back(row);
+  }
+
+  bool json = output_file.size() > 5 &&
+              output_file.compare(output_file.size() - 5, 5, ".json") == 0;
+  if (json) {
+    WriteJSON(header, rows, output_file);
+  } else {
+    WriteCSV(header, rows, output_file);
+  }
+  Abc_Print(ABC_STANDARD, "Results written to %s (%d of %zu runs failed)\n",
+            output_file.c_str(), failed, jobs.size());
+  return failed == 0 ? 0 : 1;
+}
+
+} // namespace commands
+} // namespace symmetrize
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../includes.h"
+
+namespace symmetrize {
+namespace commands {
+
+int CommandSymmetrizeBatch(Abc_Frame_t *frame, int argc, char **argv);
+
+} // namespace commands
+} // namespace symmetrize
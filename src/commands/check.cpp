@@ -0,0 +1,160 @@
+#include "check.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "common.h"
+
+#include "../aig/simulation.h"
+#include "../utils/budget.h"
+#include "../wae_factors.h"
+
+namespace symmetrize {
+namespace commands {
+
+static const char *USAGE =
+    "symm_check [-a] [-N patterns] [-e max PIs] [-j threads] [-s seed] "
+    "<reference file>\n"
+    "  compares the current network with the reference network (e.g. the\n"
+    "  one before symmetrize) by word-parallel simulation and prints the\n"
+    "  error rate of each PO and the er, awae and nawae errors with 95%\n"
+    "  confidence intervals\n"
+    "  -a: also print the POs without mismatches\n"
+    "  -N: number of random patterns (default: 2^20)\n"
+    "  -e: simulate all input patterns if there are at most this many PIs\n"
+    "      (default: 20)\n"
+    "  -j: number of threads (default: one per hardware thread)\n"
+    "  -s: seed of the random patterns (default: 0)\n";
+
+static const char *METRICS[] = {"er", "awae", "nawae"};
+
+// Quantile of the standard normal distribution for 95% confidence
+static const double Z = 1.959964;
+
+using NetworkPtr = std::unique_ptr<Abc_Ntk_t, decltype(&Abc_NtkDelete)>;
+
+// Reads the network in filename and converts it into an AIG
+static NetworkPtr ReadAIG(std::string filename) {
+  Abc_Ntk_t *ntk = Io_Read(&filename[0], Io_ReadFileType(&filename[0]), 1, 0);
+  if (ntk == nullptr) {
+    throw std::runtime_error("could not read " + filename);
+  }
+  if (!Abc_NtkIsStrash(ntk)) {
+    Abc_Ntk_t *aig = Abc_NtkStrash(ntk, 0, 1, 0);
+    Abc_NtkDelete(ntk);
+    ntk = aig;
+  }
+  return NetworkPtr(ntk, Abc_NtkDelete);
+}
+
+// Wilson score interval of a proportion of k out of n
+static std::pair<double, double> WilsonInterval(size_t k, size_t n) {
+  double p = (double)k / n, z2 = Z * Z / n;
+  double center = (p + z2 / 2) / (1 + z2);
+  double half = Z / (1 + z2) * std::sqrt(p * (1 - p) / n + z2 / (4 * n));
+  return {std::max(center - half, 0.0), std::min(center + half, 1.0)};
+}
+
+// symm_check [-a] [-N patterns] [-e max PIs] [-j threads] [-s seed]
+//            <reference file>
+int CommandCheck(Abc_Frame_t *frame, int argc, char **argv) {
+  aig::SimulationParameters param;
+  bool all = false;
+  size_t seed;
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "aNejsh")) != EOF) {
+    const char *arg;
+    if (c == 'a') {
+      all = true;
+    } else if (c == 'N' && NextArg(argc, argv, arg) &&
+               ToSize(arg, param.patterns) && param.patterns > 0) {
+      continue;
+    } else if (c == 'e' && NextArg(argc, argv, arg) &&
+               ToSize(arg, param.exhaustive_limit)) {
+      continue;
+    } else if (c == 'j' && NextArg(argc, argv, arg) &&
+               ToSize(arg, param.threads)) {
+      continue;
+    } else if (c == 's' && NextArg(argc, argv, arg) && ToSize(arg, seed)) {
+      param.seed = seed;
+    } else {
+      Abc_Print(ABC_ERROR, USAGE);
+      return 1;
+    }
+  }
+  if (globalUtilOptind + 1 != argc) {
+    Abc_Print(ABC_ERROR, USAGE);
+    return 1;
+  }
+  Abc_Ntk_t *ntk = Abc_FrameReadNtk(frame);
+  if (ntk == nullptr || !Abc_NtkIsStrash(ntk)) {
+    Abc_Print(ABC_ERROR, "The current network is not an AIG.\n");
+    return 1;
+  }
+  NetworkPtr reference = ReadAIG(argv[globalUtilOptind]);
+
+  size_t m = Abc_NtkPoNum(ntk);
+  std::vector<std::vector<double>> weights;
+  for (const char *metric : METRICS) {
+    auto &factor = WAEFactors::BY_NAME.at(metric);
+    weights.emplace_back(m);
+    for (size_t i = 0; i < m; i++) {
+      weights.back()[i] = factor(m, i);
+    }
+  }
+  utils::Budget timer;
+  auto res = aig::Simulate(ntk, reference.get(), param, weights);
+  double seconds = timer.Elapsed();
+  size_t n = res.patterns;
+
+  Abc_Print(ABC_STANDARD, "Simulated %zu %s patterns in %.2f s\n", n,
+            res.exhaustive ? "exhaustive" : "random", seconds);
+  Abc_Print(ABC_STANDARD, "%6s %-16s %12s %10s %s\n", "PO", "name",
+            "mismatches", "ER [%]", res.exhaustive ? "" : "95% CI [%]");
+  size_t exact = 0;
+  for (size_t i = 0; i < m; i++) {
+    size_t k = res.mismatches[i];
+    exact += k == 0;
+    if (k == 0 && !all)
+      continue;
+    Abc_Print(ABC_STANDARD, "%6zu %-16s %12zu %10.4f", i,
+              Abc_ObjName(Abc_NtkPo(ntk, i)), k, 100.0 * k / n);
+    if (!res.exhaustive) {
+      auto ci = WilsonInterval(k, n);
+      Abc_Print(ABC_STANDARD, " [%.4f, %.4f]", 100 * ci.first,
+                100 * ci.second);
+    }
+    Abc_Print(ABC_STANDARD, "\n");
+  }
+  Abc_Print(ABC_STANDARD, "%zu of %zu POs without mismatches\n", exact, m);
+
+  // The errors are means of the weighted mismatches per pattern, whose
+  // sample variance gives a normal approximation of the confidence interval
+  for (size_t l = 0; l < weights.size(); l++) {
+    double mean = res.weighted_sums[l] / n;
+    Abc_Print(ABC_STANDARD, "%-6s %g", METRICS[l], mean);
+    if (!res.exhaustive) {
+      double var =
+          std::max(res.weighted_squares[l] / n - mean * mean, 0.0) * n /
+          std::max<size_t>(n - 1, 1);
+      double half = Z * std::sqrt(var / n);
+      Abc_Print(ABC_STANDARD, " [%g, %g]", std::max(mean - half, 0.0),
+                mean + half);
+    }
+    Abc_Print(ABC_STANDARD, "\n");
+  }
+  Abc_Print(ABC_STANDARD, "joint error rate %.4f%%",
+            100.0 * res.joint_mismatches / n);
+  if (!res.exhaustive) {
+    auto ci = WilsonInterval(res.joint_mismatches, n);
+    Abc_Print(ABC_STANDARD, " [%.4f, %.4f]", 100 * ci.first,
+              100 * ci.second);
+  }
+  Abc_Print(ABC_STANDARD, "\n");
+  return 0;
+}
+
+} // namespace commands
+} // namespace symmetrize
@@ -1,10 +1,15 @@
 #include "commands.h"
 
+#include "batch.h"
+#include "check.h"
 #include "common.h"
 #include "gbdd.h"
 #include "netgen.h"
 #include "symmetrize.h"
 
+#include "../utils/budget.h"
+#include "../utils/trace.h"
+
 namespace symmetrize {
 namespace commands {
 
@@ -21,10 +26,46 @@ int CatchExceptions(Abc_Frame_t *frame, int argc, char **argv) {
   }
 }
 
-// runsc [command...]
+static const char *USAGE_RUNSC =
+    "runsc [-N max iterations] [-r min improvement] [-T seconds] [-v] "
+    "[command...]\n"
+    "  repeats the command until the AIG size does not change anymore and\n"
+    "  restores the smallest network seen\n"
+    "  -N: stop after the given number of iterations\n"
+    "  -r: stop once an iteration reduces the size by less than the given\n"
+    "      percentage\n"
+    "  -T: do not start another iteration after the given wall clock time\n"
+    "      in seconds\n"
+    "  -v: print size, level and time of each iteration\n";
+
+// runsc [-N max iterations] [-r min improvement] [-T seconds] [-v]
+//       [command...]
 int RepeatUntilNoSizeChange(Abc_Frame_t *frame, int argc, char **argv) {
-  if (argc == 1) {
-    Abc_Print(ABC_ERROR, "Usage: %s [command...]\n", argv[0]);
+  size_t max_iterations = 0;
+  double min_improvement = 0, seconds = 0;
+  bool verbose = false;
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "NrTvh")) != EOF) {
+    const char *arg;
+    if (c == 'v') {
+      verbose = true;
+    } else if (c == 'N' && NextArg(argc, argv, arg) &&
+               ToSize(arg, max_iterations)) {
+      continue;
+    } else if (c == 'r' && NextArg(argc, argv, arg) &&
+               ToDouble(arg, min_improvement)) {
+      continue;
+    } else if (c == 'T' && NextArg(argc, argv, arg) &&
+               ToDouble(arg, seconds) && seconds >= 0) {
+      continue;
+    } else {
+      Abc_Print(ABC_ERROR, USAGE_RUNSC);
+      return 1;
+    }
+  }
+  if (globalUtilOptind >= argc) {
+    Abc_Print(ABC_ERROR, USAGE_RUNSC);
     return 1;
   }
   Abc_Ntk_t *ntk = Abc_FrameReadNtk(frame);
@@ -33,25 +74,98 @@ int RepeatUntilNoSizeChange(Abc_Frame_t *frame, int argc, char **argv) {
     return 1;
   }
   std::string command;
-  for (int i = 1; i < argc; i++) {
-    if (i != 1)
+  for (int i = globalUtilOptind; i < argc; i++) {
+    if (i != globalUtilOptind)
       command += " ";
     command += argv[i];
   }
+
+  // The command usually replaces the current network, hence the smallest
+  // network seen is kept as a duplicate
+  utils::Budget budget(seconds);
+  Abc_Ntk_t *best = Abc_NtkDup(ntk);
+  int best_size = Abc_NtkNodeNum(ntk);
+  int best_loop = 0;
   int old_size;
-  int new_size = Abc_NtkNodeNum(ntk);
+  int new_size = best_size;
   int loops = 0;
+  bool converged;
   do {
     old_size = new_size;
+    double t_start = budget.Elapsed();
+    utils::Span span("runsc iteration");
+    span.Arg("iteration", loops + 1).Arg("size_before", old_size);
     int code = Cmd_CommandExecute(frame, command.c_str());
     if (code) {
+      Abc_NtkDelete(best);
       Abc_Print(ABC_ERROR, "Command failed with code %i\n", code);
       return code;
     }
+    ntk = Abc_FrameReadNtk(frame);
     new_size = Abc_NtkNodeNum(ntk);
     loops++;
-  } while (old_size != new_size);
-  Abc_Print(ABC_STANDARD, "Did %i loops total\n", loops);
+    span.Arg("size", new_size);
+    span.Stop();
+    if (verbose) {
+      Abc_Print(ABC_STANDARD, "Iteration %i: size %i, level %i, %.2f s\n",
+                loops, new_size, Abc_NtkLevel(ntk),
+                budget.Elapsed() - t_start);
+    }
+    if (new_size < best_size) {
+      Abc_NtkDelete(best);
+      best = Abc_NtkDup(ntk);
+      best_size = new_size;
+      best_loop = loops;
+    }
+    double improvement =
+        old_size ? (double)(old_size - new_size) / old_size : 0;
+    converged = old_size == new_size ||
+                (min_improvement > 0 && 100 * improvement < min_improvement);
+  } while (!converged &&
+           (max_iterations == 0 || (size_t)loops < max_iterations) &&
+           !budget.TimeExceeded());
+
+  if (best_size < new_size) {
+    Abc_FrameReplaceCurrentNetwork(frame, best);
+    Abc_Print(ABC_STANDARD,
+              "Did %i loops total, restored loop %i (size %i instead of %i)\n",
+              loops, best_loop, best_size, new_size);
+  } else {
+    Abc_NtkDelete(best);
+    Abc_Print(ABC_STANDARD, "Did %i loops total\n", loops);
+  }
+  return 0;
+}
+
+static const char *USAGE_TRACE =
+    "symmetrize_trace start | stop <filename>\n"
+    "  records the phases of all following commands as Chrome trace events\n"
+    "  (viewable in Perfetto or chrome://tracing) until stopped, which writes\n"
+    "  them to filename. Work done in forked worker processes only shows up\n"
+    "  as a single span of the parent.\n";
+
+// symmetrize_trace start | stop <filename>
+int CommandTrace(Abc_Frame_t *frame, int argc, char **argv) {
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "h")) != EOF) {
+    Abc_Print(ABC_ERROR, USAGE_TRACE);
+    return 1;
+  }
+  int args = argc - globalUtilOptind;
+  std::string action = args > 0 ? argv[globalUtilOptind] : "";
+  if (action == "start" && args == 1) {
+    utils::StartTracing();
+  } else if (action == "stop" && args == 2) {
+    if (!utils::Tracing()) {
+      Abc_Print(ABC_ERROR, "Tracing has not been started.\n");
+      return 1;
+    }
+    utils::StopTracing(argv[globalUtilOptind + 1]);
+  } else {
+    Abc_Print(ABC_ERROR, USAGE_TRACE);
+    return 1;
+  }
   return 0;
 }
 
@@ -60,9 +174,19 @@ void AddCommands(Abc_Frame_t *frame) {
 
   Cmd_CommandAdd(frame, "Symmetrize", "symmetrize",
                  CatchExceptions<CommandSymmetrize>, 1);
+  Cmd_CommandAdd(frame, "Symmetrize", "symmetrize_sweep",
+                 CatchExceptions<CommandSymmetrizeSweep>, 1);
+  Cmd_CommandAdd(frame, "Symmetrize", "symmetrize_batch",
+                 CatchExceptions<CommandSymmetrizeBatch>, 0);
+  Cmd_CommandAdd(frame, "Symmetrize", "symmetrize_trace",
+                 CatchExceptions<CommandTrace>, 0);
+  Cmd_CommandAdd(frame, "Symmetrize", "symm_check",
+                 CatchExceptions<CommandCheck>, 0);
 
   Cmd_CommandAdd(frame, "Symmetrize", "netgen", CatchExceptions<CommandNetgen>,
                  1);
+  Cmd_CommandAdd(frame, "Symmetrize", "netgen_batch",
+                 CatchExceptions<CommandNetgenBatch>, 0);
 
   Cmd_CommandAdd(frame, "Symmetrize", "gbdd_build",
                  CatchExceptions<CommandBuildGBDD>, 0);
@@ -25,5 +25,27 @@ bool ToDouble(const char *txt, double &res) {
   return true;
 }
 
+std::vector<std::string> Split(const std::string &txt, char separator) {
+  std::vector<std::string> parts;
+  size_t begin = 0;
+  while (true) {
+    size_t end = txt.find(separator, begin);
+    parts.push_back(txt.substr(begin, end - begin));
+    if (end == std::string::npos)
+      return parts;
+    begin = end + 1;
+  }
+}
+
+bool NextArg(int argc, char **argv, const char *&arg) {
+  if (globalUtilOptind >= argc) {
+    return false;
+  }
+  arg = argv[globalUtilOptind++];
+  return true;
+}
+
+double ToSeconds(abctime time) { return 1.0 * time / CLOCKS_PER_SEC; }
+
 } // namespace commands
 } // namespace symmetrize
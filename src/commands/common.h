@@ -2,6 +2,8 @@
 
 #include "../includes.h"
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace symmetrize {
 namespace commands {
@@ -9,5 +11,15 @@ namespace commands {
 bool ToSize(const char *txt, size_t &res);
 bool ToDouble(const char *txt, double &res);
 
+// Splits txt at every occurrence of separator
+std::vector<std::string> Split(const std::string &txt, char separator);
+
+// Consumes the argument of the option last returned by Extra_UtilGetopt and
+// stores it in arg. Returns false if there is no argument left.
+bool NextArg(int argc, char **argv, const char *&arg);
+
+// Converts a difference of Abc_Clock() values to seconds
+double ToSeconds(abctime time);
+
 } // namespace commands
 } // namespace symmetrize
@@ -1,38 +1,126 @@
 #include "gbdd.h"
 
+#include <map>
+
+#include "common.h"
+
+#include "../aig/global_bdd.h"
 #include "../aig/network.h"
 #include "../bdd/storage.h"
 
 namespace symmetrize {
 namespace commands {
 
-const char *USAGE_BUILD = "gbdd_build [dynamic reordering: 0/1]\n";
+const char *USAGE_BUILD =
+    "gbdd_build [-o order: natural/dfs/force/interleave] "
+    "[-m reordering: none/sift/symm/window] [-N node limit] [-T seconds] "
+    "[-j workers] [-r report file] [dynamic reordering: 0/1]\n"
+    "  -o: initial variable order, computed from the AIG structure\n"
+    "      (default: natural)\n"
+    "  -m: dynamic reordering method (1 is the same as -m symm, 0 the same\n"
+    "      as -m none)\n"
+    "  -N, -T: abort once more BDD nodes are alive or more wall clock time\n"
+    "      has passed\n"
+    "  -j: build groups of outputs in this many processes with separate\n"
+    "      managers and merge the results (default: 1)\n"
+    "  -r: write a JSON report with time, memory and BDD manager statistics\n";
+
+static const std::map<std::string, Cudd_ReorderingType> REORDERINGS = {
+    {"none", CUDD_REORDER_NONE},
+    {"sift", CUDD_REORDER_SIFT},
+    {"symm", CUDD_REORDER_SYMM_SIFT},
+    {"window", CUDD_REORDER_WINDOW3_CONV}};
 
+// gbdd_build [-o order] [-m reordering] [-N node limit] [-T seconds]
+//            [-j workers] [-r report file] [dynamic reordering: 0/1]
 int CommandBuildGBDD(Abc_Frame_t *frame, int argc, char **argv) {
-  if (argc != 2) {
-    Abc_Print(ABC_ERROR, USAGE_BUILD);
-    return 1;
+  aig::GlobalBDDParameters param;
+  std::string order = "natural", reordering = "none", report_file;
+  bool method_given = false;
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "omNTjrh")) != EOF) {
+    const char *arg;
+    bool valid = c != 'h' && NextArg(argc, argv, arg);
+    if (valid && c == 'o' && aig::VARIABLE_ORDERS.count(arg)) {
+      param.order = aig::VARIABLE_ORDERS.at(arg);
+      order = arg;
+    } else if (valid && c == 'm' && REORDERINGS.count(arg)) {
+      param.reorder = REORDERINGS.at(arg);
+      reordering = arg;
+      method_given = true;
+    } else if (valid && c == 'N' && ToSize(arg, param.node_limit)) {
+      continue;
+    } else if (valid && c == 'T' && ToDouble(arg, param.time_limit) &&
+               param.time_limit >= 0) {
+      continue;
+    } else if (valid && c == 'j' && ToSize(arg, param.workers) &&
+               param.workers > 0) {
+      continue;
+    } else if (valid && c == 'r') {
+      report_file = arg;
+    } else {
+      Abc_Print(ABC_ERROR, USAGE_BUILD);
+      return 1;
+    }
   }
-  std::string reorder_str = std::string(argv[1]);
-  bool reorder;
-  if (reorder_str == "0") {
-    reorder = false;
-  } else if (reorder_str == "1") {
-    reorder = true;
-  } else {
+  if (globalUtilOptind + 1 == argc) {
+    std::string reorder_str = std::string(argv[globalUtilOptind]);
+    if (reorder_str != "0" && reorder_str != "1") {
+      Abc_Print(ABC_ERROR, USAGE_BUILD);
+      return 1;
+    }
+    // The positional argument must not contradict -m
+    bool reorder = param.reorder != CUDD_REORDER_NONE;
+    if (method_given && (reorder_str == "1") != reorder) {
+      Abc_Print(ABC_ERROR, "-m %s contradicts dynamic reordering %s.\n",
+                reordering.c_str(), reorder_str.c_str());
+      return 1;
+    }
+    if (reorder_str == "1" && !reorder) {
+      param.reorder = CUDD_REORDER_SYMM_SIFT;
+      reordering = "symm";
+    }
+  } else if (globalUtilOptind != argc) {
     Abc_Print(ABC_ERROR, USAGE_BUILD);
     return 1;
   }
 
   Abc_Ntk_t *ntk = Abc_FrameReadNtk(frame);
+  if (ntk == nullptr) {
+    Abc_Print(ABC_ERROR, "No network set.\n");
+    return 1;
+  }
   if (aig::HasGlobalBDD(ntk)) {
-    Abc_Print(ABC_ERROR, "Global BDD is already set.");
+    Abc_Print(ABC_ERROR, "Global BDD is already set.\n");
     return 1;
   }
-  Abc_NtkBuildGlobalBdds(ntk, std::numeric_limits<int>::max(), 1, reorder, 0,
-                         1);
+  utils::Report report;
+  report.StartPhase("build");
+  auto stats = aig::BuildGlobalBDDs(ntk, param);
+  report.EndPhase();
+  size_t node_count = aig::GetGlobalBDD(ntk).Count();
   Abc_Print(ABC_STANDARD, "Global BDDs built successfully.\n");
-  Abc_Print(ABC_STANDARD, "Node count: %u\n", aig::GetGlobalBDD(ntk).Count());
+  Abc_Print(ABC_STANDARD, "Node count: %zu\n", node_count);
+  Abc_Print(ABC_STANDARD,
+            "Order: %s, build time: %.2f s, peak nodes: %zu, reorderings: %zu "
+            "(%.2f s)\n",
+            order.c_str(), stats.seconds, stats.peak_nodes, stats.reorderings,
+            stats.reorder_seconds);
+  if (!report_file.empty()) {
+    report.Set("command", "gbdd_build");
+    report.Set("order", order);
+    report.Set("reordering", reordering);
+    report.Set("workers", param.workers);
+    report.Set("roots", aig::GetGlobalBDD(ntk).components.size());
+    report.Set("nodes", node_count);
+    report.Set("peak_nodes", stats.peak_nodes);
+    report.Set("reorderings", stats.reorderings);
+    report.Set("reorder_seconds", stats.reorder_seconds);
+    report.Set("cudd",
+               bdd::Statistics((DdManager *)Abc_NtkGlobalBddMan(ntk)));
+    report.Write(report_file);
+  }
   return 0;
 }
 
@@ -48,15 +136,30 @@ int CommandStoreGBDD(Abc_Frame_t *frame, int argc, char **argv) {
   return 0;
 }
 
-const char *USAGE_LOAD = "gbdd_load [filename]\n";
+const char *USAGE_LOAD = "gbdd_load [-r report file] [filename]\n";
 
 int CommandLoadGBDD(Abc_Frame_t *frame, int argc, char **argv) {
-  if (argc != 2) {
+  std::string report_file;
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "rh")) != EOF) {
+    const char *arg;
+    if (c == 'r' && NextArg(argc, argv, arg)) {
+      report_file = arg;
+    } else {
+      Abc_Print(ABC_ERROR, USAGE_LOAD);
+      return 1;
+    }
+  }
+  if (globalUtilOptind + 1 != argc) {
     Abc_Print(ABC_ERROR, USAGE_LOAD);
     return 1;
   }
   Abc_Ntk_t *ntk = Abc_FrameReadNtk(frame);
-  bdd::BDDs bdd = bdd::Read(argv[1]);
+  utils::Report report;
+  report.StartPhase("load");
+  bdd::BDDs bdd = bdd::Read(argv[globalUtilOptind]);
+  report.EndPhase();
   if (bdd.components.size() != Abc_NtkCoNum(ntk)) {
     DdManager *manager = bdd.GetManager();
     bdd.components = {};
@@ -66,6 +169,14 @@ int CommandLoadGBDD(Abc_Frame_t *frame, int argc, char **argv) {
   }
   aig::SetGlobalBDDs(ntk, bdd);
   Abc_Print(ABC_STANDARD, "Success.\n");
+  if (!report_file.empty()) {
+    report.Set("command", "gbdd_load");
+    report.Set("file", argv[globalUtilOptind]);
+    report.Set("roots", bdd.components.size());
+    report.Set("nodes", bdd.Count());
+    report.Set("cudd", bdd::Statistics(bdd.GetManager()));
+    report.Write(report_file);
+  }
   return 0;
 }
 
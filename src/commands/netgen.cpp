@@ -1,9 +1,13 @@
 #include "netgen.h"
 
 #include <algorithm>
+#include <filesystem>
+#include <fstream>
 
 #include "../aig/circuits.h"
 #include "../aig/network.h"
+#include "../bdd/storage.h"
+#include "../utils/process.h"
 #include "common.h"
 
 namespace symmetrize {
@@ -19,20 +23,10 @@ std::vector<std::string> NET_TYPES = {"adder", "multiplier", "mac",
                                       "asymmetric"};
 std::vector<int> ARG_COUNT = {3, 3, 4, 4};
 
-int CommandNetgen(Abc_Frame_t *frame, int argc, char **argv) {
-  if (argc < 2) {
-    PrintUsage();
-    return 1;
-  }
-  size_t typeId =
-      std::distance(NET_TYPES.begin(),
-                    std::find(NET_TYPES.begin(), NET_TYPES.end(), argv[1]));
-  size_t n;
-  if (typeId == NET_TYPES.size() || argc != ARG_COUNT[typeId] ||
-      !ToSize(argv[2], n)) {
-    PrintUsage();
-    return 1;
-  }
+// Generates a network of the given type with n bits/PIs and m pairs/POs.
+// Returns nullptr if the type is unknown or the sanity check fails.
+static Abc_Ntk_t *Generate(size_t typeId, size_t n, size_t m,
+                           std::optional<unsigned> seed = std::nullopt) {
   Abc_Ntk_t *ntk = aig::Create();
   aig::Signals out;
   if (typeId == 0) { // Adder
@@ -45,41 +39,257 @@ int CommandNetgen(Abc_Frame_t *frame, int argc, char **argv) {
     auto b = aig::AddPIs(ntk, n);
     out = aig::Multiplier(ntk, a, b);
     aig::SetName(ntk, "multiply" + std::to_string(n));
-  } else {
-    size_t m;
-    if (!ToSize(argv[3], m)) {
-      PrintUsage();
-      return 1;
+  } else if (typeId == 2) { // MAC
+    aig::NumberPairs pairs;
+    for (size_t i = 0; i < m; i++) {
+      pairs.emplace_back(aig::AddPIs(ntk, n), aig::AddPIs(ntk, n));
     }
-    if (typeId == 2) { // MAC
-      aig::NumberPairs pairs;
-      for (size_t i = 0; i < m; i++) {
-        pairs.emplace_back(aig::AddPIs(ntk, n), aig::AddPIs(ntk, n));
-      }
-      out = aig::MAC(ntk, pairs);
-      aig::SetName(ntk, "mac " + std::to_string(m) + " x multiply" +
-                            std::to_string(n));
-    } else if (typeId == 3) { // Asymmetric
-      out.reserve(m);
-      auto in = aig::AddPIs(ntk, n);
-      for (size_t i = 0; i < m; i++) {
-        out.emplace_back(aig::RandomMaximallyAsymmetric(ntk, in));
-      }
-      aig::SetName(ntk, "rand max asymm B^" + std::to_string(n) + " -> B^" +
-                            std::to_string(m));
-    } else {
-      PrintUsage();
-      return 1;
+    out = aig::MAC(ntk, pairs);
+    aig::SetName(ntk, "mac " + std::to_string(m) + " x multiply" +
+                          std::to_string(n));
+  } else if (typeId == 3) { // Asymmetric
+    out.reserve(m);
+    auto in = aig::AddPIs(ntk, n);
+    for (size_t i = 0; i < m; i++) {
+      out.emplace_back(
+          seed ? aig::RandomMaximallyAsymmetric(ntk, in, *seed + i)
+               : aig::RandomMaximallyAsymmetric(ntk, in));
     }
+    aig::SetName(ntk, "rand max asymm B^" + std::to_string(n) + " -> B^" +
+                          std::to_string(m));
+  } else {
+    Abc_NtkDelete(ntk);
+    return nullptr;
   }
   aig::AddPOs(ntk, out);
   if (!aig::CleanupAndCheck(ntk)) {
     Abc_Print(ABC_ERROR, "Network sanity check failed\n");
+    Abc_NtkDelete(ntk);
+    return nullptr;
+  }
+  return ntk;
+}
+
+static size_t TypeId(const char *type) {
+  return std::distance(NET_TYPES.begin(),
+                       std::find(NET_TYPES.begin(), NET_TYPES.end(), type));
+}
+
+Abc_Ntk_t *GenerateNetwork(const std::string &type, size_t n, size_t m,
+                           std::optional<unsigned> seed) {
+  return Generate(TypeId(type.c_str()), n, m, seed);
+}
+
+int CommandNetgen(Abc_Frame_t *frame, int argc, char **argv) {
+  if (argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+  size_t typeId = TypeId(argv[1]);
+  size_t n;
+  size_t m = 0;
+  if (typeId == NET_TYPES.size() || argc != ARG_COUNT[typeId] ||
+      !ToSize(argv[2], n) || (argc > 3 && !ToSize(argv[3], m))) {
+    PrintUsage();
+    return 1;
+  }
+  Abc_Ntk_t *ntk = Generate(typeId, n, m);
+  if (ntk == nullptr) {
     return 1;
   }
   Abc_FrameReplaceCurrentNetwork(frame, ntk);
   return 0;
 }
 
+// +----------------------------------------------------------+
+// |                          BATCH                           |
+// +----------------------------------------------------------+
+
+const char *USAGE_BATCH =
+    "netgen_batch [-j workers] [-t timeout] [-d directory] "
+    "[-c optimization command] [-r dynamic reordering: 0/1]\n"
+    "             [adder/multiplier] [start bits] [end bits] [stride]\n"
+    "netgen_batch [...] [mac] [start bits] [end bits] [stride] "
+    "[start pairs] [end pairs]\n"
+    "netgen_batch [...] [asymmetric] [start PIs] [end PIs] [stride] "
+    "<n POs>\n"
+    "  -j: number of workers (default: 1); with more, the timings are\n"
+    "      measured under contention\n";
+
+// Prefixes of the generated files and default directory per network type,
+// matching the names used by preprocess.py
+std::vector<std::string> BATCH_NAMES = {"add", "mult", "mac", "asymm"};
+
+struct BatchJob {
+  std::string name;
+  size_t n, m;
+};
+
+struct BatchParameters {
+  size_t type;
+  std::string directory;
+  std::string optimization_command = "runsc resyn2";
+  bool reorder = true;
+};
+
+static std::string PreprocessJob(Abc_Frame_t *frame, const BatchParameters &p,
+                                 const BatchJob &job) {
+  Abc_Ntk_t *ntk = Generate(p.type, job.n, job.m);
+  if (ntk == nullptr) {
+    throw std::runtime_error("network generation failed");
+  }
+  Abc_FrameReplaceCurrentNetwork(frame, ntk);
+
+  abctime t_start = Abc_Clock();
+  if (!p.optimization_command.empty() &&
+      Cmd_CommandExecute(frame, p.optimization_command.c_str())) {
+    throw std::runtime_error("optimization command failed");
+  }
+  double t_opt = ToSeconds(Abc_Clock() - t_start);
+  ntk = Abc_FrameReadNtk(frame);
+  size_t n_aig = Abc_NtkNodeNum(ntk);
+
+  t_start = Abc_Clock();
+  if (Abc_NtkBuildGlobalBdds(ntk, std::numeric_limits<int>::max(), 1,
+                             p.reorder, 0, 0) == nullptr) {
+    throw std::runtime_error("building global BDDs failed");
+  }
+  double t_gbdd = ToSeconds(Abc_Clock() - t_start);
+  bdd::BDDs bdd = aig::GetGlobalBDD(ntk);
+  size_t n_bdd = bdd.Count();
+
+  // The BDD file is written last and renamed afterwards, so that a file pair
+  // is only considered complete if the job finished
+  std::string base = p.directory + "/" + job.name;
+  std::string write_aig = "write " + base + ".aig";
+  if (Cmd_CommandExecute(frame, write_aig.c_str())) {
+    throw std::runtime_error("writing AIG failed");
+  }
+  bdd::Write(bdd, base + ".bdd.part");
+  std::filesystem::rename(base + ".bdd.part", base + ".bdd");
+
+  return std::to_string(t_opt) + ";" + std::to_string(n_aig) + ";" +
+         std::to_string(t_gbdd) + ";" + std::to_string(n_bdd);
+}
+
+static std::string StatusString(utils::ForkedResult::Status status) {
+  switch (status) {
+  case utils::ForkedResult::Status::SUCCESS:
+    return "done";
+  case utils::ForkedResult::Status::TIMEOUT:
+    return "timeout";
+  default:
+    return "failed";
+  }
+}
+
+// netgen_batch [-j workers] [-t timeout] [-d directory]
+//              [-c optimization command] [-r dynamic reordering: 0/1]
+//              [type] [start] [end] [stride] <pairs/POs>
+int CommandNetgenBatch(Abc_Frame_t *frame, int argc, char **argv) {
+  BatchParameters p;
+  size_t workers = 1;
+  double timeout = 0;
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "jtdcrh")) != EOF) {
+    const char *arg;
+    bool valid = c != 'h' && NextArg(argc, argv, arg);
+    if (valid && c == 'j') {
+      valid = ToSize(arg, workers) && workers > 0;
+    } else if (valid && c == 't') {
+      valid = ToDouble(arg, timeout);
+    } else if (valid && c == 'd') {
+      p.directory = arg;
+    } else if (valid && c == 'c') {
+      p.optimization_command = arg;
+    } else if (valid && c == 'r') {
+      valid = std::string(arg) == "0" || std::string(arg) == "1";
+      p.reorder = std::string(arg) == "1";
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      Abc_Print(ABC_ERROR, USAGE_BATCH);
+      return 1;
+    }
+  }
+
+  int n_args = argc - globalUtilOptind;
+  char **args = argv + globalUtilOptind;
+  size_t start, end, stride;
+  if (n_args < 4 || (p.type = TypeId(args[0])) == NET_TYPES.size() ||
+      !ToSize(args[1], start) || !ToSize(args[2], end) ||
+      !ToSize(args[3], stride) || stride == 0) {
+    Abc_Print(ABC_ERROR, USAGE_BATCH);
+    return 1;
+  }
+  size_t m_start = 1, m_end = 1;
+  bool valid;
+  if (p.type == 2) { // MAC
+    valid = n_args == 6 && ToSize(args[4], m_start) && ToSize(args[5], m_end);
+  } else if (p.type == 3) { // Asymmetric
+    valid = n_args == 4 || (n_args == 5 && ToSize(args[4], m_start));
+    m_end = m_start;
+  } else {
+    valid = n_args == 4;
+  }
+  if (!valid) {
+    Abc_Print(ABC_ERROR, USAGE_BATCH);
+    return 1;
+  }
+
+  const std::string &prefix = BATCH_NAMES[p.type];
+  if (p.directory.empty()) {
+    p.directory = "benchmark/preprocessed/" + prefix;
+  }
+  std::filesystem::create_directories(p.directory);
+
+  std::vector<BatchJob> jobs;
+  std::vector<std::string> skipped;
+  for (size_t m = m_start; m <= m_end; m++) {
+    for (size_t n = start; n <= end; n += stride) {
+      std::string name = prefix + (p.type == 2 ? std::to_string(m) + "x" : "") +
+                         std::to_string(n);
+      std::string base = p.directory + "/" + name;
+      if (std::filesystem::exists(base + ".aig") &&
+          std::filesystem::exists(base + ".bdd")) {
+        skipped.push_back(name);
+      } else {
+        jobs.push_back({name, n, m});
+      }
+    }
+  }
+  Abc_Print(ABC_STANDARD, "Generating %zu networks (%zu already present)\n",
+            jobs.size(), skipped.size());
+
+  size_t finished = 0;
+  auto results = utils::RunForked(
+      jobs.size(), workers,
+      [&](size_t i) { return PreprocessJob(frame, p, jobs[i]); }, timeout,
+      [&](size_t i, const utils::ForkedResult &result) {
+        Abc_Print(ABC_STANDARD, "[%zu/%zu] %s: %s (%.2f sec)\n", ++finished,
+                  jobs.size(), jobs[i].name.c_str(),
+                  StatusString(result.status).c_str(), result.seconds);
+      });
+
+  // Timing manifest
+  std::ofstream manifest(p.directory + "/netgen_batch.csv");
+  manifest << "name;status;t_opt;n_aig;t_gbdd;n_bdd\n";
+  for (auto &name : skipped) {
+    manifest << name << ";skipped;-;-;-;-\n";
+  }
+  int failed = 0;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    bool success = results[i].status == utils::ForkedResult::Status::SUCCESS;
+    manifest << jobs[i].name << ";" << StatusString(results[i].status) << ";"
+             << (success ? results[i].output : "-;-;-;-") << "\n";
+    failed += success ? 0 : 1;
+  }
+  Abc_Print(ABC_STANDARD, "Manifest written to %s/netgen_batch.csv\n",
+            p.directory.c_str());
+  return failed == 0 ? 0 : 1;
+}
+
 } // namespace commands
 } // namespace symmetrize
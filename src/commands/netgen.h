@@ -2,10 +2,21 @@
 
 #include "../includes.h"
 
+#include <optional>
+#include <string>
+
 namespace symmetrize {
 namespace commands {
 
+// Generates a network of the given type (adder, multiplier, mac or
+// asymmetric) with n bits/PIs and m pairs/POs. Asymmetric networks are
+// random, unless a seed is given (output i uses seed + i). Returns nullptr if
+// the type is unknown or the sanity check fails.
+Abc_Ntk_t *GenerateNetwork(const std::string &type, size_t n, size_t m,
+                           std::optional<unsigned> seed = std::nullopt);
+
 int CommandNetgen(Abc_Frame_t *frame, int argc, char **argv);
+int CommandNetgenBatch(Abc_Frame_t *frame, int argc, char **argv);
 
 } // namespace commands
 } // namespace symmetrize
@@ -1,26 +1,285 @@
 #include "symmetrize.h"
 
+#include <algorithm>
+#include <fstream>
+
 #include "common.h"
 
+#include "../aig/network.h"
 #include "../componentwise.h"
+#include "../utils/truth_table.h"
 
 namespace symmetrize {
 namespace commands {
 
 static const char *USAGE =
-    "symmetrize [error: er/awae/nawae] [error bound] [profit: const/aig/bdd] "
-    "<optimization command>\n";
+    "symmetrize [-nxi] [-P min BDD profit] [-S solver: greedy/bnb/dp] "
+    "[-L seconds] [-B blocks] [-W delay weight] [-p probability file] "
+    "[-w word error: mae/mse] [-T seconds] [-M megabytes] "
+    "[-C checkpoint directory] [-R checkpoint directory] [-K shards] "
+    "[-j shard workers] [-r report file] [-d diagnostics file] "
+    "[error: er/awae/nawae] [error bound] "
+    "[profit: const/aig/bdd/delay/areadelay] <optimization command>\n"
+    "  -n: only estimate the selection, leaving the network unchanged\n"
+    "      (not with -T, -M, -C, -R and the delay and areadelay profits)\n"
+    "  -x: bound the exact joint error rate (percentage of inputs on which\n"
+    "      any output differs) instead of the sum of the output errors,\n"
+    "      requires er\n"
+    "  -i: search input polarities, i.e., symmetrize with respect to\n"
+    "      partially complemented inputs\n"
+    "  -P: do not realize components with a smaller BDD size profit\n"
+    "  -S: knapsack solver (default: greedy, not with -x)\n"
+    "  -L: time limit of the bnb solver, returns the best selection found\n"
+    "  -B: also consider symmetry within blocks of PIs, given as 'auto' or\n"
+    "      as ranges of PI indices, e.g. 0-7,8-15 (remaining PIs form an\n"
+    "      additional block)\n"
+    "  -W: weight of the level difference in the areadelay profit "
+    "(default: 1)\n"
+    "  -p: weight the inputs by the probability of each PI to be one, given\n"
+    "      as one probability per line or as a trace of input patterns\n"
+    "      (one string of 0s and 1s per line, PI 0 first)\n"
+    "  -w: choose the symmetric function minimizing the mean absolute or\n"
+    "      squared error of the output word (PO i has weight 2^i) and\n"
+    "      report that error\n"
+    "  -T, -M: wall clock and BDD memory budget; when running short, the\n"
+    "      optimization is skipped, the profit falls back to bdd or const\n"
+    "      and only evaluated candidates are selected (same on Ctrl-C)\n"
+    "  -C: write a checkpoint to the directory after each phase\n"
+    "  -R: resume from the checkpoint in the directory, skipping completed\n"
+    "      phases (requires the same network and options)\n"
+    "  -K: split the POs into this many shards approximated by separate\n"
+    "      processes, each building only the BDDs of its cones (global BDDs\n"
+    "      are not required)\n"
+    "  -j: maximum number of shard processes running at once (default: one\n"
+    "      per hardware thread)\n"
+    "  -r: write a JSON report with time, CPU time and memory per phase,\n"
+    "      BDD manager statistics, sizes, the selection and the error\n"
+    "  -d: write a CSV file with errors, sizes, profits and the selection of\n"
+    "      each component\n";
+
+// Reads the probability of each of the n PIs to be one from filename. The
+// file either contains one probability per line or a trace of input patterns
+// from which the probabilities are estimated. Lines starting with # are
+// ignored.
+static std::vector<double> ReadInputProbabilities(const std::string &filename,
+                                                  size_t n) {
+  std::ifstream in(filename);
+  if (!in) {
+    throw std::runtime_error("could not open " + filename);
+  }
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(in, line)) {
+    while (!line.empty() && isspace(line.back()))
+      line.pop_back();
+    if (!line.empty() && line[0] != '#')
+      lines.push_back(line);
+  }
+  if (lines.empty()) {
+    throw std::invalid_argument("no probabilities in " + filename);
+  }
+
+  bool trace = n > 1 && lines[0].size() == n &&
+               lines[0].find_first_not_of("01") == std::string::npos;
+  std::vector<double> probabilities(n, 0);
+  if (trace) {
+    for (auto &pattern : lines) {
+      if (pattern.size() != n ||
+          pattern.find_first_not_of("01") != std::string::npos) {
+        throw std::invalid_argument("invalid input pattern " + pattern);
+      }
+      for (size_t i = 0; i < n; i++) {
+        probabilities[i] += pattern[i] == '1';
+      }
+    }
+    for (auto &p : probabilities) {
+      p /= lines.size();
+    }
+    return probabilities;
+  }
+  if (lines.size() != n) {
+    throw std::invalid_argument("expected " + std::to_string(n) +
+                                " probabilities in " + filename);
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (!ToDouble(lines[i].c_str(), probabilities[i]) ||
+        probabilities[i] < 0 || probabilities[i] > 1) {
+      throw std::invalid_argument("invalid probability " + lines[i]);
+    }
+  }
+  return probabilities;
+}
+
+// Parses blocks given as 'auto' or comma separated ranges of PI indices
+static bool ParseBlocks(Abc_Ntk_t *ntk, const std::string &spec,
+                        InputBlocks &blocks) {
+  if (spec == "auto") {
+    blocks = aig::GroupPIsByName(ntk);
+    return true;
+  }
+  size_t n = Abc_NtkPiNum(ntk);
+  std::vector<bool> covered(n, false);
+  for (auto &range : Split(spec, ',')) {
+    auto bounds = Split(range, '-');
+    size_t from, to;
+    if (bounds.empty() || bounds.size() > 2 ||
+        !ToSize(bounds.front().c_str(), from) ||
+        !ToSize(bounds.back().c_str(), to) || from > to || to >= n)
+      return false;
+    std::vector<int> block;
+    for (size_t i = from; i <= to; i++) {
+      if (covered[i])
+        return false;
+      covered[i] = true;
+      block.push_back(i);
+    }
+    blocks.push_back(block);
+  }
+  std::vector<int> remaining;
+  for (size_t i = 0; i < n; i++) {
+    if (!covered[i])
+      remaining.push_back(i);
+  }
+  if (!remaining.empty())
+    blocks.push_back(remaining);
+  return true;
+}
+
+// Parses the options -S, -L and -W shared by symmetrize and symmetrize_sweep
+static bool ParseSolverOption(int c, const char *arg, std::string &solver,
+                              double &time_limit, double &delay_weight) {
+  if (c == 'S') {
+    solver = arg;
+    return std::find(KnapsackSolvers::NAMES.begin(),
+                     KnapsackSolvers::NAMES.end(),
+                     solver) != KnapsackSolvers::NAMES.end();
+  }
+  if (c == 'W')
+    return ToDouble(arg, delay_weight);
+  return c == 'L' && ToDouble(arg, time_limit) && time_limit >= 0;
+}
 
-// symmetrize [error: er/awae/nawae] [error bound] [profit: const/aig/bdd]
-//            <optimization command>
+// Looks up the profit metric with the given name
+static bool ParseProfitMetric(const std::string &name, double delay_weight,
+                              ProfitMetric &metric) {
+  if (name == "areadelay") {
+    metric = ProfitMetrics::AreaDelay(delay_weight);
+    return true;
+  }
+  auto it = ProfitMetrics::BY_NAME.find(name);
+  if (it == ProfitMetrics::BY_NAME.end())
+    return false;
+  metric = it->second;
+  return true;
+}
+
+// Joins all arguments except for the checkpoint directory, the budgets and
+// the report and diagnostics files, which may change when resuming
+static std::string CheckpointSettings(int argc, char **argv) {
+  std::string settings;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-C" || arg == "-R" || arg == "-T" || arg == "-M" ||
+        arg == "-r" || arg == "-d") {
+      i++;
+      continue;
+    }
+    settings += (settings.empty() ? "" : " ") + arg;
+  }
+  return settings;
+}
+
+// symmetrize [-nxi] [-P min BDD profit] [-S solver] [-L seconds] [-B blocks]
+//            [-W delay weight] [-p probability file] [-w word error]
+//            [-T seconds] [-M megabytes] [-C directory] [-R directory]
+//            [-K shards] [-j shard workers] [-r report file]
+//            [-d diagnostics file]
+//            [error: er/awae/nawae] [error bound]
+//            [profit: const/aig/bdd/delay/areadelay] <optimization command>
 int CommandSymmetrize(Abc_Frame_t *frame, int argc, char **argv) {
+  ComponentwiseSymmetrizationParameters param;
+  param.frame = frame;
+  param.ntk = Abc_FrameReadNtk(frame);
+  param.checkpoint_settings = CheckpointSettings(argc, argv);
+  std::string solver = "greedy", report_file;
+  double time_limit = 0, delay_weight = 1;
+  bool solver_given = false;
+
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "nxiPSLBWpwTMCRKjrdh")) != EOF) {
+    const char *arg;
+    double value;
+    if (c == 'n') {
+      param.dry_run = true;
+    } else if (c == 'x') {
+      param.joint_error_rate = true;
+    } else if (c == 'i') {
+      param.polarity_search = true;
+    } else if (c == 'P' && NextArg(argc, argv, arg) && ToDouble(arg, value)) {
+      param.min_bdd_profit = (Profit)value;
+    } else if ((c == 'S' || c == 'L' || c == 'W') &&
+               NextArg(argc, argv, arg) &&
+               ParseSolverOption(c, arg, solver, time_limit, delay_weight)) {
+      solver_given |= c != 'W';
+    } else if (c == 'B' && param.ntk && NextArg(argc, argv, arg) &&
+               ParseBlocks(param.ntk, arg, param.blocks)) {
+      continue;
+    } else if (c == 'p' && param.ntk && NextArg(argc, argv, arg)) {
+      param.input_probabilities =
+          ReadInputProbabilities(arg, Abc_NtkPiNum(param.ntk));
+    } else if (c == 'w' && NextArg(argc, argv, arg) &&
+               (!strcmp(arg, "mae") || !strcmp(arg, "mse"))) {
+      param.word_error_metric = !strcmp(arg, "mae")
+                                    ? bdd::WordErrorMetric::MAE
+                                    : bdd::WordErrorMetric::MSE;
+    } else if (c == 'T' && NextArg(argc, argv, arg) &&
+               ToDouble(arg, param.time_budget) && param.time_budget >= 0) {
+      continue;
+    } else if (c == 'M' && NextArg(argc, argv, arg) && ToDouble(arg, value) &&
+               value >= 0) {
+      param.memory_budget = value * 1024 * 1024;
+    } else if ((c == 'C' || c == 'R') && NextArg(argc, argv, arg)) {
+      param.checkpoint_directory = arg;
+      param.resume = c == 'R';
+    } else if (c == 'K' && NextArg(argc, argv, arg) &&
+               ToSize(arg, param.shards) && param.shards > 0) {
+      continue;
+    } else if (c == 'j' && NextArg(argc, argv, arg) &&
+               ToSize(arg, param.shard_workers) && param.shard_workers > 0) {
+      continue;
+    } else if (c == 'r' && NextArg(argc, argv, arg)) {
+      report_file = arg;
+    } else if (c == 'd' && NextArg(argc, argv, arg)) {
+      param.diagnostics_file = arg;
+    } else {
+      Abc_Print(ABC_ERROR, USAGE);
+      return 1;
+    }
+  }
+  argc -= globalUtilOptind - 1;
+  argv += globalUtilOptind - 1;
+
+  // The joint error rate is bounded by a greedy selection of its own
+  if (param.joint_error_rate && solver_given) {
+    Abc_Print(ABC_ERROR, "-S and -L cannot be combined with -x.\n");
+    return 1;
+  }
+  // Estimates neither write nor resume checkpoints
+  if (param.dry_run && !param.checkpoint_directory.empty()) {
+    Abc_Print(ABC_ERROR, "-n cannot be combined with -C or -R.\n");
+    return 1;
+  }
+  // Estimates do not degrade, hence a budget would not be enforced
+  if (param.dry_run && (param.time_budget > 0 || param.memory_budget > 0)) {
+    Abc_Print(ABC_ERROR, "-n cannot be combined with -T or -M.\n");
+    return 1;
+  }
+
   if (argc < 4) {
     Abc_Print(ABC_ERROR, USAGE);
     return 1;
   }
-  ComponentwiseSymmetrizationParameters param;
-  param.frame = frame;
-  param.ntk = Abc_FrameReadNtk(frame);
 
   if (argc > 4) {
     param.optimization_command = argv[4];
@@ -28,7 +287,8 @@ int CommandSymmetrize(Abc_Frame_t *frame, int argc, char **argv) {
 
   {
     auto it = WAEFactors::BY_NAME.find(argv[1]);
-    if (it == WAEFactors::BY_NAME.end()) {
+    if (it == WAEFactors::BY_NAME.end() ||
+        (param.joint_error_rate && it->first != "er")) {
       Abc_Print(ABC_ERROR, USAGE);
       return 1;
     }
@@ -40,16 +300,162 @@ int CommandSymmetrize(Abc_Frame_t *frame, int argc, char **argv) {
     return 1;
   }
 
-  {
-    auto it = ProfitMetrics::BY_NAME.find(argv[3]);
-    if (it == ProfitMetrics::BY_NAME.end()) {
-      Abc_Print(ABC_ERROR, USAGE);
+  if (!ParseProfitMetric(argv[3], delay_weight, param.profit_metric)) {
+    Abc_Print(ABC_ERROR, USAGE);
+    return 1;
+  }
+  // Without realizing f_tilde, its levels are unknown
+  std::string metric_name = argv[3];
+  if (param.dry_run && (metric_name == "delay" || metric_name == "areadelay")) {
+    Abc_Print(ABC_ERROR, "-n cannot be combined with delay or areadelay.\n");
+    return 1;
+  }
+
+  auto knapsack_solver = KnapsackSolvers::Create(solver, time_limit);
+  param.knapsack_solver = knapsack_solver.get();
+  utils::Report report;
+  if (!report_file.empty()) {
+    param.report = &report;
+    report.Set("command", "symmetrize");
+    report.Set("settings", param.checkpoint_settings);
+  }
+  Symmetrize(param);
+  if (!report_file.empty()) {
+    report.Write(report_file);
+  }
+  return 0;
+}
+
+static const char *USAGE_SWEEP =
+    "symmetrize_sweep [-P min BDD profit] [-S solver: greedy/bnb/dp] "
+    "[-L seconds] [-W delay weight] [-p probability file] [-o CSV file] "
+    "[-j JSON file] [-m point] [error: er/awae/nawae] "
+    "[error bounds: b1,b2,...] "
+    "[profits: const,aig,bdd,delay,areadelay] <optimization command>\n"
+    "  -m: replace the current network by the given point of the sweep\n"
+    "  -S, -L, -W, -p: knapsack solver, time limit, delay weight and input\n"
+    "      probabilities, see symmetrize\n";
+
+static void WriteCSV(const std::vector<SweepPoint> &points,
+                     const std::string &filename) {
+  std::ofstream out(filename);
+  out << "point;profit;threshold;error;n_aig;n_bdd;selection;pareto;gap;"
+         "depth\n";
+  for (size_t i = 0; i < points.size(); i++) {
+    auto &pt = points[i];
+    out << i << ";" << pt.profit_metric << ";" << pt.error_bound << ";"
+        << pt.error << ";" << pt.aig_size << ";" << pt.bdd_size << ";"
+        << tt::ToString(pt.selection) << ";" << (pt.pareto_optimal ? 1 : 0)
+        << ";" << pt.gap << ";" << pt.depth << "\n";
+  }
+}
+
+static void WriteJSON(const std::vector<SweepPoint> &points,
+                      const std::string &filename) {
+  std::ofstream out(filename);
+  out << "[\n";
+  for (size_t i = 0; i < points.size(); i++) {
+    auto &pt = points[i];
+    out << "  {\"point\": " << i << ", \"profit\": \"" << pt.profit_metric
+        << "\", \"threshold\": " << pt.error_bound
+        << ", \"error\": " << pt.error << ", \"n_aig\": " << pt.aig_size
+        << ", \"n_bdd\": " << pt.bdd_size << ", \"selection\": \""
+        << tt::ToString(pt.selection) << "\", \"pareto\": "
+        << (pt.pareto_optimal ? "true" : "false") << ", \"gap\": " << pt.gap
+        << ", \"depth\": " << pt.depth << "}"
+        << (i + 1 < points.size() ? "," : "") << "\n";
+  }
+  out << "]\n";
+}
+
+// symmetrize_sweep [-P min BDD profit] [-S solver] [-L seconds]
+//                  [-W delay weight] [-p probability file] [-o CSV file]
+//                  [-j JSON file] [-m point]
+//                  [error: er/awae/nawae] [error bounds] [profits]
+//                  <optimization command>
+int CommandSymmetrizeSweep(Abc_Frame_t *frame, int argc, char **argv) {
+  SweepParameters param;
+  param.base.frame = frame;
+  param.base.ntk = Abc_FrameReadNtk(frame);
+  std::string csv_file, json_file;
+  std::string solver = "greedy";
+  double time_limit = 0, delay_weight = 1;
+
+  int c;
+  Extra_UtilGetoptReset();
+  while ((c = Extra_UtilGetopt(argc, argv, "PSLWpojmh")) != EOF) {
+    const char *arg;
+    bool valid = c != 'h' && NextArg(argc, argv, arg);
+    double value;
+    size_t index;
+    if (valid && c == 'P' && ToDouble(arg, value)) {
+      param.base.min_bdd_profit = (Profit)value;
+    } else if (valid &&
+               ParseSolverOption(c, arg, solver, time_limit, delay_weight)) {
+      continue;
+    } else if (valid && c == 'p' && param.base.ntk) {
+      param.base.input_probabilities =
+          ReadInputProbabilities(arg, Abc_NtkPiNum(param.base.ntk));
+    } else if (valid && c == 'o') {
+      csv_file = arg;
+    } else if (valid && c == 'j') {
+      json_file = arg;
+    } else if (valid && c == 'm' && ToSize(arg, index)) {
+      param.materialize = index;
+    } else {
+      Abc_Print(ABC_ERROR, USAGE_SWEEP);
       return 1;
     }
-    param.profit_metric = it->second;
+  }
+  argc -= globalUtilOptind - 1;
+  argv += globalUtilOptind - 1;
+  if (argc < 4) {
+    Abc_Print(ABC_ERROR, USAGE_SWEEP);
+    return 1;
+  }
+  if (argc > 4) {
+    param.base.optimization_command = argv[4];
   }
 
-  Symmetrize(param);
+  auto factors = WAEFactors::BY_NAME.find(argv[1]);
+  if (factors == WAEFactors::BY_NAME.end()) {
+    Abc_Print(ABC_ERROR, USAGE_SWEEP);
+    return 1;
+  }
+  param.base.factors = factors->second;
+  for (auto &bound : Split(argv[2], ',')) {
+    double value;
+    if (!ToDouble(bound.c_str(), value)) {
+      Abc_Print(ABC_ERROR, USAGE_SWEEP);
+      return 1;
+    }
+    param.error_bounds.push_back(value);
+  }
+  for (auto &name : Split(argv[3], ',')) {
+    ProfitMetric metric;
+    if (!ParseProfitMetric(name, delay_weight, metric)) {
+      Abc_Print(ABC_ERROR, USAGE_SWEEP);
+      return 1;
+    }
+    param.profit_metrics.emplace_back(name, metric);
+  }
+
+  auto knapsack_solver = KnapsackSolvers::Create(solver, time_limit);
+  param.base.knapsack_solver = knapsack_solver.get();
+  auto points = Sweep(param);
+  for (size_t i = 0; i < points.size(); i++) {
+    auto &pt = points[i];
+    Abc_Print(ABC_STANDARD,
+              "%3zu %-9s threshold %-8g error %-10.4f AIG %-8zu BDD %-8zu "
+              "depth %-4zu gap %6.2f%% %s %s\n",
+              i, pt.profit_metric.c_str(), pt.error_bound, pt.error,
+              pt.aig_size, pt.bdd_size, pt.depth, 100.0 * pt.gap,
+              tt::ToString(pt.selection).c_str(), pt.pareto_optimal ? "*" : "");
+  }
+  if (!csv_file.empty())
+    WriteCSV(points, csv_file);
+  if (!json_file.empty())
+    WriteJSON(points, json_file);
   return 0;
 }
 
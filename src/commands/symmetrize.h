@@ -6,6 +6,7 @@ namespace symmetrize {
 namespace commands {
 
 int CommandSymmetrize(Abc_Frame_t *frame, int argc, char **argv);
+int CommandSymmetrizeSweep(Abc_Frame_t *frame, int argc, char **argv);
 
 } // namespace commands
 } // namespace symmetrize
@@ -1,13 +1,26 @@
 #include "componentwise.h"
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <utility>
 
+#include "checkpoint.h"
+
+#include "aig/global_bdd.h"
 #include "aig/network.h"
 #include "aig/symmetric.h"
 
 #include "bdd/ch.h"
+#include "bdd/joint_error.h"
+#include "bdd/storage.h"
 #include "bdd/symmetric.h"
 
+#include "utils/budget.h"
+#include "utils/process.h"
+#include "utils/trace.h"
 #include "utils/vector.h"
 
 namespace symmetrize {
@@ -19,9 +32,14 @@ namespace symmetrize {
 std::map<std::string, ProfitMetric> ProfitMetrics::BY_NAME = {
     {"const", ProfitMetrics::Constant},
     {"aig", ProfitMetrics::AigSizeDifference},
-    {"bdd", ProfitMetrics::BddSizeDifference}};
+    {"bdd", ProfitMetrics::BddSizeDifference},
+    {"delay", ProfitMetrics::LevelDifference},
+    {"areadelay", ProfitMetrics::AreaDelay(1)}};
 
 Profit ProfitMetrics::AigSizeDifference(ProfitMetricParameters p) {
+  // Without a realization of f_tilde_i, the BDD sizes serve as estimate
+  if (p.f_tilde_i_po == nullptr)
+    return BddSizeDifference(p);
   return (ssize_t)aig::CountNodesFor({p.f_i_po}) -
          (ssize_t)aig::CountNodesFor({p.f_tilde_i_po});
 }
@@ -30,6 +48,18 @@ Profit ProfitMetrics::BddSizeDifference(ProfitMetricParameters p) {
          (Profit)bdd::BDDs{{p.f_tilde_i_bdd}}.Count();
 }
 Profit ProfitMetrics::Constant(ProfitMetricParameters) { return 1; }
+Profit ProfitMetrics::LevelDifference(ProfitMetricParameters p) {
+  // Without a realization of f_tilde_i, its level is unknown
+  if (p.f_tilde_i_po == nullptr)
+    return Constant(p);
+  return (Profit)aig::Level(p.f_i_po) - (Profit)aig::Level(p.f_tilde_i_po);
+}
+ProfitMetric ProfitMetrics::AreaDelay(double delay_weight) {
+  return [delay_weight](ProfitMetricParameters p) {
+    return AigSizeDifference(p) +
+           (Profit)std::round(delay_weight * LevelDifference(p));
+  };
+}
 
 // +----------------------------------------------------------+
 // |                        Symmetrize                        |
@@ -38,20 +68,36 @@ Profit ProfitMetrics::Constant(ProfitMetricParameters) { return 1; }
 utils::GreedyApproximateKnapsackSolver<double, Profit> DEFAULT_SOLVER =
     utils::GreedyApproximateKnapsackSolver<double, Profit>();
 
+std::vector<std::string> KnapsackSolvers::NAMES = {"greedy", "bnb", "dp"};
+
+std::unique_ptr<utils::KnapsackSolver<double, Profit>>
+KnapsackSolvers::Create(const std::string &name, double time_limit) {
+  if (name == "greedy")
+    return std::make_unique<
+        utils::GreedyApproximateKnapsackSolver<double, Profit>>();
+  if (name == "bnb")
+    return std::make_unique<utils::BranchAndBoundKnapsackSolver<double, Profit>>(
+        time_limit);
+  if (name == "dp")
+    return std::make_unique<
+        utils::DynamicProgrammingKnapsackSolver<double, Profit>>();
+  throw std::invalid_argument("unknown knapsack solver " + name);
+}
+
 // Source: A. Bernasconi, V. Ciriani and T. Villa,
 // "Exploiting Symmetrization and D-Reducibility for Approximate Logic
 // Synthesis," in IEEE Transactions on Computers, vol. 71, no. 1, pp. 121-133,
 // 1 Jan. 2022, doi: 10.1109/TC.2020.3043476.
+//
+// totals[i] is the (weighted) amount of inputs with Hamming weight i.
 static std::pair<ValueVector, ValueCount>
-CalculateValueVector(const ValueCountsHW &T,
-                     const BinomialCoefficients<ValueCount> &binomial) {
+CalculateValueVector(const ValueCountsHW &T, const ValueCount *totals) {
   size_t n = T.size() - 1;
 
   ValueVector vector(n + 1);
   ValueCount e = 0;
-  const ValueCount *coefficients = binomial[n];
   for (int i = 0; i <= n; i++) {
-    ValueCount zeros = coefficients[i] - T[i];
+    ValueCount zeros = totals[i] - T[i];
     if (T[i] > zeros) {
       vector[i] = true;
       e += zeros;
@@ -63,14 +109,14 @@ CalculateValueVector(const ValueCountsHW &T,
   return {vector, e};
 }
 
-SymmetricFunction
+static SymmetricFunction
 CalculateSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
-                           const BinomialCoefficients<ValueCount> &binomial) {
+                           const ValueCount *totals) {
   size_t m = Ts.size();
   std::vector<ValueVector> vvs(m);
   std::vector<ValueCount> hds(m);
   for (size_t i = 0; i < m; i++) {
-    auto vv_hd = CalculateValueVector(Ts[i], binomial);
+    auto vv_hd = CalculateValueVector(Ts[i], totals);
     vvs[i] = vv_hd.first;
     hds[i] = vv_hd.second;
   }
@@ -80,102 +126,1291 @@ CalculateSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
           .hamming_distances = hds};
 }
 
-void Symmetrize(ComponentwiseSymmetrizationParameters p) {
-  // TODO: keep names
-  if (p.ntk == nullptr || !Abc_NtkIsStrash(p.ntk)) {
+SymmetricFunction
+CalculateSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
+                           const BinomialCoefficients<ValueCount> &binomial) {
+  return CalculateSymmetricFunction(Ts, Ts.empty() ? nullptr
+                                                   : binomial[Ts[0].size() - 1]);
+}
+
+SymmetricFunction
+CalculateSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
+                           const ValueCountsHW &totals) {
+  return CalculateSymmetricFunction(Ts, totals.data());
+}
+
+BlockSymmetricFunction
+CalculateBlockSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
+                                const InputBlocks &blocks,
+                                const ValueCountsHW &totals) {
+  size_t n = 0;
+  for (auto &block : blocks) {
+    n += block.size();
+  }
+
+  BlockSymmetricFunction f = {.n = n, .m = Ts.size(), .blocks = blocks};
+  for (auto &T : Ts) {
+    ValueVector vector(T.size());
+    ValueCount e = 0;
+    for (size_t idx = 0; idx < T.size(); idx++) {
+      ValueCount zeros = totals[idx] - T[idx];
+      vector[idx] = T[idx] > zeros;
+      e += vector[idx] ? zeros : T[idx];
+    }
+    f.components.push_back(vector);
+    f.hamming_distances.push_back(e);
+  }
+  return f;
+}
+
+// Total error of the nearest symmetric function for the given C_H tables
+static double TotalError(const ComponentwiseSymmetrizationParameters &p,
+                         const std::vector<ValueCountsHW> &Ts,
+                         const BinomialCoefficients<ValueCount> &binomial) {
+  auto f_tilde = CalculateSymmetricFunction(Ts, binomial);
+  double error = 0;
+  for (size_t i = 0; i < f_tilde.m; i++) {
+    error += f_tilde.hamming_distances[i] * p.factors(f_tilde.m, i);
+  }
+  return error;
+}
+
+// Local search over the input polarities minimizing the total error of the
+// nearest symmetric function: inputs are flipped one at a time and the flip
+// is kept if it reduces the error, until a pass over all inputs brings no
+// improvement. Returns the C_H tables for the final polarity.
+static std::vector<ValueCountsHW>
+SearchPolarity(const ComponentwiseSymmetrizationParameters &p,
+               const bdd::BDDs &f_bdd, size_t n,
+               const BinomialCoefficients<ValueCount> &binomial,
+               std::vector<bool> &inverted) {
+  const size_t MAX_PASSES = 8;
+  bdd::PolarityCounter counter(f_bdd, n, binomial);
+  auto Ts = counter.C_H();
+  double error = TotalError(p, Ts, binomial);
+  bool improved = true;
+  for (size_t pass = 0; improved && pass < MAX_PASSES; pass++) {
+    improved = false;
+    for (size_t var = 0; var < n; var++) {
+      counter.SetInverted(var, !counter.Inverted()[var]);
+      auto flipped_Ts = counter.C_H();
+      double flipped_error = TotalError(p, flipped_Ts, binomial);
+      if (flipped_error < error) {
+        error = flipped_error;
+        Ts = std::move(flipped_Ts);
+        improved = true;
+      } else {
+        counter.SetInverted(var, !counter.Inverted()[var]);
+      }
+    }
+  }
+  inverted = counter.Inverted();
+  return Ts;
+}
+
+// Returns the indices of all components that may be selected: components
+// whose error alone exceeds the error bound can never be part of a solution,
+// components that are exactly symmetric gain nothing and components whose
+// BDD size profit is below the optional minimum are considered not worth
+// realizing.
+static std::vector<size_t>
+PreselectCandidates(const ComponentwiseSymmetrizationParameters &p,
+                    const std::vector<double> &e_i,
+                    const std::vector<bool> &exact, const bdd::BDDs &f_bdd,
+                    const bdd::BDDs &f_tilde_bdds) {
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < e_i.size(); i++) {
+    if (e_i[i] > p.error_bound || exact[i])
+      continue;
+    if (p.min_bdd_profit &&
+        (Profit)bdd::BDDs{{f_bdd.components[i]}}.Count() -
+                (Profit)bdd::BDDs{{f_tilde_bdds.components[i]}}.Count() <
+            *p.min_bdd_profit)
+      continue;
+    candidates.push_back(i);
+  }
+  return candidates;
+}
+
+static void CheckNetwork(Abc_Ntk_t *ntk) {
+  if (ntk == nullptr || !Abc_NtkIsStrash(ntk)) {
     throw std::invalid_argument("given network is not an AIG");
   }
-  if (!aig::HasGlobalBDD(p.ntk)) {
+  if (!aig::HasGlobalBDD(ntk)) {
     throw std::invalid_argument("global BDDs for given network not set");
   }
-  if (Abc_NtkCiNum(p.ntk) != Abc_NtkPiNum(p.ntk)) {
+  if (Abc_NtkCiNum(ntk) != Abc_NtkPiNum(ntk)) {
     throw std::invalid_argument("symmetrization does only support "
                                 "combinatorial logic");
   }
-  size_t n = Abc_NtkPiNum(p.ntk);
-  size_t m = Abc_NtkPoNum(p.ntk);
+}
+
+// The nearest fully symmetric function of a network together with everything
+// derived from it that does not require touching the AIG
+struct Approximation {
+  size_t n, m;
+  bdd::BDDs f_bdd;
+  SymmetricFunction f_tilde;
+  bdd::BDDs f_tilde_bdds;
+  std::vector<double> e_i;
+  std::vector<size_t> candidates;
+
+  // The nearest block symmetric function, only set if blocks are given
+  BlockSymmetricFunction f_block;
+  bdd::BDDs f_block_bdds;
+  std::vector<double> e_block_i;
+  std::vector<size_t> block_candidates;
+
+  // Components with f_tilde_i = f_i (constant or already symmetric). They
+  // are never candidates, hence bypass the BDD and AIG construction.
+  std::vector<bool> exact;
+
+  abctime t_symm, t_bdd;
+  // Time spent evaluating the profits of each component
+  std::vector<abctime> t_profit;
+
+  bool HasBlocks() const { return !f_block.blocks.empty(); }
+};
+
+// Returns for each component whether f_tilde_i is f_i itself. Without input
+// probabilities, this is the case iff the Hamming distance is 0. Otherwise,
+// inputs of probability 0 do not count, hence f_i also has to be symmetric
+// with the same value vector.
+static std::vector<bool>
+ExactComponents(const ComponentwiseSymmetrizationParameters &p,
+                const Approximation &a) {
+  std::vector<bool> exact(a.m, false);
+  for (size_t i = 0; i < a.m; i++) {
+    if (a.f_tilde.hamming_distances[i] != 0)
+      continue;
+    auto &f_i = a.f_bdd.components[i];
+    exact[i] = p.input_probabilities.empty() ||
+               (bdd::IsSymmetric(f_i, a.n) &&
+                bdd::ValueVectorOf(f_i, a.n) == a.f_tilde.components[i]);
+  }
+  return exact;
+}
+
+// Creates the BDDs of the given (block) symmetric function, except for the
+// exact components, which are f_i itself
+template <typename Function>
+static bdd::BDDs CreateBDDs(const Approximation &a, const Function &f) {
+  utils::Span span("CreateBDDs");
+  std::vector<size_t> inexact;
+  for (size_t i = 0; i < a.m; i++) {
+    if (!a.exact[i])
+      inexact.push_back(i);
+  }
+  span.Arg("components", inexact.size());
+  Function g = f;
+  g.m = inexact.size();
+  g.components = utils::Subset(f.components, inexact);
+  g.hamming_distances = utils::Subset(f.hamming_distances, inexact);
+  auto created = bdd::Create(a.f_bdd.GetManager(), g);
+  bdd::BDDs bdds = a.f_bdd;
+  for (size_t c = 0; c < inexact.size(); c++) {
+    bdds.components[inexact[c]] = created.components[c];
+  }
+  return bdds;
+}
+
+// Scales the Hamming distances of the components to their errors
+static std::vector<double>
+ComponentErrors(const ComponentwiseSymmetrizationParameters &p,
+                const std::vector<ValueCount> &hamming_distances, size_t n) {
+  std::vector<double> e_i = hamming_distances;
+  double n_exp = exp2(n);
+  for (size_t i = 0; i < e_i.size(); i++) {
+    e_i[i] *= p.factors(e_i.size(), i) / n_exp;
+  }
+  return e_i;
+}
+
+// Calculates the nearest fully symmetric function of the components f
+static SymmetricFunction
+NearestSymmetricFunction(const ComponentwiseSymmetrizationParameters &p,
+                         const bdd::BDDs &f, size_t n) {
   BinomialCoefficients<ValueCount> binomial(n);
+  if (p.word_error_metric) {
+    return bdd::WordSymmetricFunction(f, n, p.input_probabilities,
+                                      *p.word_error_metric);
+  }
+  if (p.polarity_search) {
+    std::vector<bool> inverted;
+    auto Ts = SearchPolarity(p, f, n, binomial, inverted);
+    auto f_tilde = CalculateSymmetricFunction(Ts, binomial);
+    f_tilde.inverted_inputs = inverted;
+    return f_tilde;
+  }
+  if (p.input_probabilities.empty()) {
+    return CalculateSymmetricFunction(bdd::C_H(f, n, binomial), binomial);
+  }
+  // Full symmetry is symmetry within a single block of all inputs
+  InputBlocks all(1);
+  for (size_t i = 0; i < n; i++) {
+    all[0].push_back(i);
+  }
+  return CalculateSymmetricFunction(
+      bdd::C_H(f, n, all, p.input_probabilities),
+      bdd::BlockTotals(all, p.input_probabilities));
+}
 
-  // Retrieve BDD from network and take ownership of manager
-  std::unique_ptr<DdManager, void (*)(DdManager *)> mgr_ptr(
-      (DdManager *)Abc_NtkGlobalBddMan(p.ntk), Cudd_Quit);
-  auto f_bdd = aig::GetGlobalBDD(p.ntk);
-  Abc_NtkFreeGlobalBdds(p.ntk, 0);
+// Calculates the nearest fully symmetric function f_tilde and, if blocks are
+// given, the nearest block symmetric function. Components that are already
+// symmetric are their own nearest symmetric function and skip the C_H
+// computation. With polarity search, only constant components are skipped
+// (as they are symmetric in every polarity), with word error metrics none
+// (as the word is approximated as a whole).
+static void CalculateFunctions(const ComponentwiseSymmetrizationParameters &p,
+                               Approximation &a) {
+  utils::Span span("CalculateFunctions");
+  if (p.polarity_search &&
+      (p.word_error_metric || !p.input_probabilities.empty())) {
+    throw std::invalid_argument("polarity search does not support input "
+                                "probabilities or word error metrics");
+  }
+  std::vector<bool> symmetric(a.m, false);
+  std::vector<size_t> asymmetric;
+  for (size_t i = 0; i < a.m; i++) {
+    auto &f_i = a.f_bdd.components[i];
+    symmetric[i] = !p.word_error_metric &&
+                   (p.polarity_search ? Cudd_IsConstant(f_i.Get())
+                                      : bdd::IsSymmetric(f_i, a.n));
+    if (!symmetric[i])
+      asymmetric.push_back(i);
+  }
 
-  size_t aig_size_before = Abc_NtkNodeNum(p.ntk);
-  size_t bdd_size_before = f_bdd.Count();
+  span.Arg("asymmetric", asymmetric.size());
+  SymmetricFunction rest{.n = a.n, .m = 0};
+  if (!asymmetric.empty()) {
+    // The error factors (used by the polarity search) depend on the index
+    // among all components
+    auto q = p;
+    q.factors = [&](size_t, size_t c) { return p.factors(a.m, asymmetric[c]); };
+    rest = NearestSymmetricFunction(
+        q, {utils::Subset(a.f_bdd.components, asymmetric)}, a.n);
+  }
+  a.f_tilde = {.n = a.n,
+               .m = a.m,
+               .components = std::vector<ValueVector>(a.m),
+               .hamming_distances = std::vector<ValueCount>(a.m, 0),
+               .inverted_inputs = rest.inverted_inputs};
+  for (size_t i = 0; i < a.m; i++) {
+    if (symmetric[i])
+      a.f_tilde.components[i] =
+          bdd::ValueVectorOf(a.f_bdd.components[i], a.n);
+  }
+  for (size_t c = 0; c < asymmetric.size(); c++) {
+    a.f_tilde.components[asymmetric[c]] = rest.components[c];
+    a.f_tilde.hamming_distances[asymmetric[c]] = rest.hamming_distances[c];
+  }
+
+  if (!p.blocks.empty()) {
+    a.f_block = CalculateBlockSymmetricFunction(
+        bdd::C_H(a.f_bdd, a.n, p.blocks, p.input_probabilities), p.blocks,
+        bdd::BlockTotals(p.blocks, p.input_probabilities));
+  }
+}
+
+// Computes the approximation of f_bdd. The symmetric functions are taken from
+// the checkpoint if it already contains them and stored in it otherwise.
+static Approximation Approximate(const ComponentwiseSymmetrizationParameters &p,
+                                 bdd::BDDs f_bdd,
+                                 const Checkpoint *checkpoint = nullptr) {
+  utils::Span span("Approximate");
+  Approximation a;
+  a.n = Abc_NtkPiNum(p.ntk);
+  a.m = f_bdd.components.size();
+  span.Arg("components", a.m);
+  a.f_bdd = std::move(f_bdd);
+  a.t_profit.assign(a.m, 0);
 
   // Calculate nearest fully symmetric function f_tilde
   auto t_start = Abc_Clock();
-  auto Ts = bdd::C_H(f_bdd, n, binomial);
-  auto f_tilde = CalculateSymmetricFunction(Ts, binomial);
-  Abc_PrintTime(ABC_VERBOSE, "t_symm", Abc_Clock() - t_start);
+  if (checkpoint && checkpoint->HasFunctions()) {
+    checkpoint->LoadFunctions(a.f_tilde, a.f_block);
+  } else {
+    CalculateFunctions(p, a);
+    if (checkpoint)
+      checkpoint->SaveFunctions(a.f_tilde, a.f_block);
+  }
+  a.t_symm = Abc_Clock() - t_start;
 
-  // Add POs for f_tilde to AIG
+  // Compute BDDs of f_tilde
   t_start = Abc_Clock();
-  aig::AddSymmetricPOs(p.ntk, f_tilde);
+  a.exact = ExactComponents(p, a);
+  a.f_tilde_bdds = CreateBDDs(a, a.f_tilde);
+  if (a.HasBlocks()) {
+    a.f_block_bdds = CreateBDDs(a, a.f_block);
+  }
+  a.t_bdd = Abc_Clock() - t_start;
+
+  a.e_i = ComponentErrors(p, a.f_tilde.hamming_distances, a.n);
+  a.candidates =
+      PreselectCandidates(p, a.e_i, a.exact, a.f_bdd, a.f_tilde_bdds);
+  if (a.HasBlocks()) {
+    a.e_block_i = ComponentErrors(p, a.f_block.hamming_distances, a.n);
+    a.block_candidates = PreselectCandidates(p, a.e_block_i, a.exact,
+                                             a.f_bdd, a.f_block_bdds);
+  }
+  return a;
+}
+
+// Returns the part of f_tilde that shall be realized in the AIG
+static SymmetricFunction CandidateFunction(const Approximation &a) {
+  return {.n = a.n,
+          .m = a.candidates.size(),
+          .components = utils::Subset(a.f_tilde.components, a.candidates),
+          .hamming_distances =
+              utils::Subset(a.f_tilde.hamming_distances, a.candidates),
+          .inverted_inputs = a.f_tilde.inverted_inputs};
+}
+
+// Returns the part of the block symmetric function that shall be realized
+static BlockSymmetricFunction CandidateBlockFunction(const Approximation &a) {
+  return {.n = a.n,
+          .m = a.block_candidates.size(),
+          .blocks = a.f_block.blocks,
+          .components =
+              utils::Subset(a.f_block.components, a.block_candidates),
+          .hamming_distances =
+              utils::Subset(a.f_block.hamming_distances, a.block_candidates)};
+}
+
+// POs of f_i, f_tilde_i and the block symmetric f_block_i in a network where
+// the candidates of f_tilde and then those of f_block have been added after
+// the original POs. Components without candidate POs point to the original
+// PO.
+struct RealizedPOs {
+  aig::Signals f_i_aig;
+  aig::Signals f_tilde_i_aig;
+  aig::Signals f_block_i_aig;
+};
+
+static RealizedPOs GetRealizedPOs(Abc_Ntk_t *ntk, const Approximation &a) {
+  auto pos = aig::GetPOs(ntk);
+  aig::Signals f_i_aig(pos.begin(), pos.begin() + a.m);
+  aig::Signals f_tilde_i_aig = f_i_aig;
+  aig::Signals f_block_i_aig = f_i_aig;
+  for (size_t c = 0; c < a.candidates.size(); c++) {
+    f_tilde_i_aig[a.candidates[c]] = pos[a.m + c];
+  }
+  size_t offset = a.m + a.candidates.size();
+  for (size_t c = 0; c < a.block_candidates.size(); c++) {
+    f_block_i_aig[a.block_candidates[c]] = pos[offset + c];
+  }
+  return {f_i_aig, f_tilde_i_aig, f_block_i_aig};
+}
+
+// Profits of the candidates of f_tilde and of the block symmetric function
+struct Profits {
+  std::vector<Profit> full;
+  std::vector<Profit> block;
+};
+
+static std::vector<Profit>
+ComputeProfits(const ProfitMetric &metric, Approximation &a,
+               const std::vector<size_t> &candidates, bdd::BDDs &f_tilde_bdds,
+               const aig::Signals &f_i_aig, const aig::Signals *f_tilde_i_aig,
+               const utils::Budget *budget) {
+  std::vector<Profit> profits(candidates.size());
+  for (size_t c = 0; c < candidates.size(); c++) {
+    if (budget && budget->Exhausted()) {
+      profits.resize(c);
+      break;
+    }
+    size_t i = candidates[c];
+    utils::Span span("profit");
+    span.Arg("component", i);
+    auto t_start = Abc_Clock();
+    profits[c] =
+        metric({.i = i,
+                .f_i_po = f_i_aig[i],
+                .f_tilde_i_po = f_tilde_i_aig ? (*f_tilde_i_aig)[i] : nullptr,
+                .f_i_bdd = a.f_bdd.components[i],
+                .f_tilde_i_bdd = f_tilde_bdds.components[i]});
+    a.t_profit[i] += Abc_Clock() - t_start;
+  }
+  return profits;
+}
+
+// Computes the profits of the candidates. The POs of f_tilde_i are passed as
+// nullptr if realized is not given. If the budget is exhausted, the
+// evaluation stops early and only the evaluated candidates are kept.
+static Profits ComputeProfits(const ProfitMetric &metric, Approximation &a,
+                              const aig::Signals &f_i_aig,
+                              const RealizedPOs *realized,
+                              const utils::Budget *budget = nullptr) {
+  Profits profits;
+  profits.full =
+      ComputeProfits(metric, a, a.candidates, a.f_tilde_bdds, f_i_aig,
+                     realized ? &realized->f_tilde_i_aig : nullptr, budget);
+  profits.block =
+      ComputeProfits(metric, a, a.block_candidates, a.f_block_bdds, f_i_aig,
+                     realized ? &realized->f_block_i_aig : nullptr, budget);
+  a.candidates.resize(profits.full.size());
+  a.block_candidates.resize(profits.block.size());
+  return profits;
+}
+
+// Selection over all m components. Components in selection are replaced by
+// f_tilde_i, components in block by the block symmetric f_block_i. The weight
+// is the error.
+struct Selection : utils::KnapsackSolution<double> {
+  std::vector<bool> block;
+};
+
+// Chooses between the original, the block symmetric and the fully symmetric
+// component by solving a multiple-choice knapsack problem
+static Selection SelectWithBlocks(const ComponentwiseSymmetrizationParameters &p,
+                                  const Approximation &a,
+                                  const Profits &profits) {
+  std::vector<std::vector<double>> weights(a.m);
+  std::vector<std::vector<Profit>> class_profits(a.m);
+  std::vector<std::vector<bool>> is_block(a.m);
+  for (size_t c = 0; c < a.candidates.size(); c++) {
+    size_t i = a.candidates[c];
+    weights[i].push_back(a.e_i[i]);
+    class_profits[i].push_back(profits.full[c]);
+    is_block[i].push_back(false);
+  }
+  for (size_t c = 0; c < a.block_candidates.size(); c++) {
+    size_t i = a.block_candidates[c];
+    weights[i].push_back(a.e_block_i[i]);
+    class_profits[i].push_back(profits.block[c]);
+    is_block[i].push_back(true);
+  }
+
+  auto mckp = utils::GreedyMultipleChoiceKnapsackSolver<double, Profit>()
+                  .Optimize(weights, class_profits, p.error_bound);
+  Selection s;
+  s.weight = mckp.weight;
+  s.profit = mckp.profit;
+  s.bound = mckp.bound;
+  s.selection.assign(a.m, false);
+  s.block.assign(a.m, false);
+  for (size_t i = 0; i < a.m; i++) {
+    if (mckp.choice[i] == mckp.NONE)
+      continue;
+    if (is_block[i][mckp.choice[i]])
+      s.block[i] = true;
+    else
+      s.selection[i] = true;
+  }
+  return s;
+}
+
+// Greedily adds the candidates (of f_tilde and f_block) by decreasing profit
+// per error as long as the exact joint error rate stays within the bound. As
+// the union of mismatches only grows, a candidate that is rejected once is
+// never feasible later on, hence a single pass suffices.
+static Selection SelectJointly(const ComponentwiseSymmetrizationParameters &p,
+                               const Approximation &a,
+                               const Profits &profits) {
+  struct Item {
+    size_t i;
+    bool block;
+    Profit profit;
+    bdd::BDD mismatch;
+    double error;
+  };
+  bdd::JointError joint(a.f_bdd.GetManager(), a.n, p.input_probabilities);
+  std::vector<Item> items;
+  auto add_items = [&](const std::vector<size_t> &candidates,
+                       const bdd::BDDs &bdds, const std::vector<Profit> &ps,
+                       bool block) {
+    for (size_t c = 0; c < candidates.size(); c++) {
+      size_t i = candidates[c];
+      if (ps[c] <= 0)
+        continue;
+      auto mismatch =
+          bdd::Mismatch(a.f_bdd.components[i], bdds.components[i]);
+      double error = 100 * joint.Probability(mismatch);
+      items.push_back({i, block, ps[c], mismatch, error});
+    }
+  };
+  add_items(a.candidates, a.f_tilde_bdds, profits.full, false);
+  add_items(a.block_candidates, a.f_block_bdds, profits.block, true);
+  std::stable_sort(items.begin(), items.end(),
+                   [](const Item &x, const Item &y) {
+                     return x.profit * y.error > y.profit * x.error;
+                   });
+
+  // Trivial bound: the best candidate of every component is selected
+  std::vector<Profit> best(a.m, 0);
+  for (auto &item : items) {
+    best[item.i] = std::max(best[item.i], item.profit);
+  }
+
+  Selection s;
+  s.selection.assign(a.m, false);
+  s.block.assign(a.m, false);
+  for (Profit profit : best) {
+    s.bound += profit;
+  }
+  for (auto &item : items) {
+    if (s.selection[item.i] || s.block[item.i])
+      continue;
+    if (100 * joint.With(item.mismatch) > p.error_bound)
+      continue;
+    joint.Add(item.mismatch);
+    s.profit += item.profit;
+    (item.block ? s.block : s.selection)[item.i] = true;
+  }
+  s.weight = 100 * joint.Get();
+  return s;
+}
+
+// Solves the knapsack problem over the candidates
+static Selection SelectComponents(const ComponentwiseSymmetrizationParameters &p,
+                                  const Approximation &a,
+                                  const Profits &profits) {
+  utils::Span span("SelectComponents");
+  span.Arg("candidates", a.candidates.size() + a.block_candidates.size());
+  if (p.joint_error_rate)
+    return SelectJointly(p, a, profits);
+  if (a.HasBlocks())
+    return SelectWithBlocks(p, a, profits);
+  Selection s;
+  static_cast<utils::KnapsackSolution<double> &>(s) =
+      p.knapsack_solver->Optimize(utils::Subset(a.e_i, a.candidates),
+                                  profits.full, p.error_bound);
+  std::vector<bool> sigma(a.m, false);
+  for (size_t c = 0; c < a.candidates.size(); c++) {
+    sigma[a.candidates[c]] = s.selection[c];
+  }
+  s.selection = sigma;
+  s.block.assign(a.m, false);
+  return s;
+}
+
+// Returns the BDDs of f_hat for the given selection
+static bdd::BDDs SelectBDDs(const Approximation &a, const Selection &s) {
+  auto f_hat_bdd = bdd::BDDs::Select(a.f_tilde_bdds, a.f_bdd, s.selection);
+  if (a.HasBlocks())
+    f_hat_bdd = bdd::BDDs::Select(a.f_block_bdds, f_hat_bdd, s.block);
+  return f_hat_bdd;
+}
+
+// Returns the POs of f_hat for the given selection
+static aig::Signals SelectPOs(const RealizedPOs &realized, const Selection &s) {
+  auto f_hat_aig =
+      utils::Select(realized.f_tilde_i_aig, realized.f_i_aig, s.selection);
+  return utils::Select(realized.f_block_i_aig, f_hat_aig, s.block);
+}
+
+// Replaces all POs of ntk by the selected ones of f_tilde, f_block and f
+static void RewirePOs(Abc_Ntk_t *ntk, const RealizedPOs &realized,
+                      const Selection &s) {
+  utils::Span span("RewirePOs");
+  auto f_hat_aig = SelectPOs(realized, s);
+  for (auto &obj : f_hat_aig) {
+    obj = Abc_ObjFanin(obj, 0);
+  }
+  while (Abc_NtkPoNum(ntk) != 0) {
+    Abc_NtkDeleteObj(Abc_NtkPo(ntk, 0));
+  }
+  aig::AddPOs(ntk, f_hat_aig);
+}
+
+// Components replaced by their block symmetric approximation are marked by b
+static std::string ToString(const Selection &s) {
+  std::string res = tt::ToString(s.selection);
+  for (size_t i = 0; i < s.block.size(); i++) {
+    if (s.block[i])
+      res[i] = 'b';
+  }
+  return res;
+}
+
+static void PrintSelection(const Selection &s) {
+  size_t n_sigma = 0;
+  for (size_t i = 0; i < s.selection.size(); i++) {
+    if (s.selection[i] || s.block[i]) {
+      n_sigma++;
+    }
+  }
+  Abc_Print(ABC_STANDARD, "Selection: %s (%.2f%% of components)\n",
+            ToString(s).c_str(), 100.0 * n_sigma / s.selection.size());
+  Abc_Print(ABC_STANDARD, "Total error: %.2f\n", s.weight);
+}
+
+static void PrintKnapsack(const Selection &s) {
+  Abc_Print(ABC_STANDARD, "Knapsack: profit %.0f, bound %.2f (gap %.2f%%)\n",
+            s.profit, s.bound, 100.0 * s.Gap());
+}
+
+static void PrintWordError(const ComponentwiseSymmetrizationParameters &p,
+                           const bdd::BDDs &f, const bdd::BDDs &f_hat) {
+  if (!p.word_error_metric)
+    return;
+  bool mae = *p.word_error_metric == bdd::WordErrorMetric::MAE;
+  double error = bdd::WordError(f, f_hat, p.input_probabilities,
+                                *p.word_error_metric);
+  double max = exp2(f.components.size()) - 1;
+  Abc_Print(ABC_STANDARD, "Word error: %s %.4f (%.4f%% of max)\n",
+            mae ? "MAE" : "MSE", error,
+            100 * error / (mae ? max : max * max));
+}
+
+static void PrintPolarity(const Approximation &a) {
+  auto &inverted = a.f_tilde.inverted_inputs;
+  if (inverted.empty())
+    return;
+  Abc_Print(ABC_STANDARD, "Inverted inputs: %s (%zu of %zu)\n",
+            tt::ToString(inverted).c_str(),
+            (size_t)std::count(inverted.begin(), inverted.end(), true),
+            inverted.size());
+}
+
+static void PrintCandidates(const Approximation &a) {
+  Abc_Print(ABC_STANDARD,
+            "Candidates: %zu of %zu components (%zu already symmetric)\n",
+            a.candidates.size(), a.m,
+            (size_t)std::count(a.exact.begin(), a.exact.end(), true));
+}
+
+static void PrintBlocks(const Approximation &a) {
+  if (!a.HasBlocks())
+    return;
+  std::string sizes;
+  for (auto &block : a.f_block.blocks) {
+    sizes += (sizes.empty() ? "" : ", ") + std::to_string(block.size());
+  }
+  Abc_Print(ABC_STANDARD,
+            "Blocks: %zu (%s), block candidates: %zu of %zu components\n",
+            a.f_block.blocks.size(), sizes.c_str(), a.block_candidates.size(),
+            a.m);
+}
+
+static double ToSeconds(abctime time) { return 1.0 * time / CLOCKS_PER_SEC; }
+
+// Adds the sizes, the selection and the error to the report
+static void ReportResult(utils::Report &report, const SymmetrizationResult &r,
+                         const Approximation &a, const Selection &s) {
+  report.Set("components", a.m);
+  report.Set("candidates", a.candidates.size());
+  report.Set("block_candidates", a.block_candidates.size());
+  report.Set("exact", (size_t)std::count(a.exact.begin(), a.exact.end(), true));
+  report.Set("aig_size_before", r.aig_size_before);
+  report.Set("aig_size_after", r.aig_size_after);
+  report.Set("bdd_size_before", r.bdd_size_before);
+  report.Set("bdd_size_after", r.bdd_size_after);
+  report.Set("selection", r.selection);
+  report.Set("error", r.error);
+  report.Set("knapsack_profit", s.profit);
+  report.Set("knapsack_bound", s.bound);
+  report.Set("knapsack_gap", s.Gap());
+}
+
+// Adds the statistics of the manager and of the C_H tables to the report
+static void ReportBDDs(utils::Report &report, DdManager *mgr) {
+  auto ch = bdd::ReadCacheStatistics();
+  utils::Report ch_report;
+  ch_report.Set("lookups", ch.lookups);
+  ch_report.Set("hits", ch.hits);
+  ch_report.Set("hit_rate", ch.lookups ? (double)ch.hits / ch.lookups : 0.0);
+  report.Set("ch_tables", ch_report);
+  report.Set("cudd", bdd::Statistics(mgr));
+}
 
-  // Optimize
+// Why a component is (not) a candidate, see PreselectCandidates
+static const char *
+CandidateStatus(const ComponentwiseSymmetrizationParameters &p,
+                const Approximation &a, size_t i, bool candidate) {
+  if (a.exact[i])
+    return "exact";
+  if (candidate)
+    return "candidate";
+  if (a.e_i[i] > p.error_bound &&
+      (!a.HasBlocks() || a.e_block_i[i] > p.error_bound))
+    return "over_bound";
+  if (p.min_bdd_profit &&
+      (Profit)bdd::BDDs{{a.f_bdd.components[i]}}.Count() -
+              (Profit)bdd::BDDs{{a.f_tilde_bdds.components[i]}}.Count() <
+          *p.min_bdd_profit)
+    return "low_bdd_profit";
+  // Dropped when the budget ran out before its profit was evaluated
+  return "not_evaluated";
+}
+
+// Writes one line per component with its errors, sizes, profits and whether
+// it was selected, see ComponentwiseSymmetrizationParameters::diagnostics_file.
+// Must be called before the POs are rewired. realized may be nullptr if the
+// candidates have not been added to the AIG.
+static void WriteDiagnostics(const ComponentwiseSymmetrizationParameters &p,
+                             Approximation &a,
+                             const aig::Signals &f_i_aig,
+                             const RealizedPOs *realized,
+                             const Profits &profits, const Selection &s) {
+  std::ofstream out(p.diagnostics_file);
+  if (!out) {
+    throw std::runtime_error("could not write diagnostics to " +
+                             p.diagnostics_file);
+  }
+  std::vector<std::string> profit(a.m, "-"), block_profit(a.m, "-");
+  std::vector<bool> full(a.m, false), candidate(a.m, false);
+  for (size_t c = 0; c < a.candidates.size(); c++) {
+    profit[a.candidates[c]] = std::to_string(profits.full[c]);
+    full[a.candidates[c]] = candidate[a.candidates[c]] = true;
+  }
+  for (size_t c = 0; c < a.block_candidates.size(); c++) {
+    block_profit[a.block_candidates[c]] = std::to_string(profits.block[c]);
+    candidate[a.block_candidates[c]] = true;
+  }
+
+  out << "index;name;status;hamming_distance;error_rate;error;block_error;"
+         "n_bdd;n_bdd_symmetric;n_aig;n_aig_symmetric;profit;block_profit";
+  for (auto &metric : ProfitMetrics::BY_NAME) {
+    out << ";profit_" << metric.first;
+  }
+  out << ";selected;t_profit\n";
+  std::string selection = ToString(s);
+  double n_exp = exp2(a.n);
+  for (size_t i = 0; i < a.m; i++) {
+    Abc_Obj_t *f_tilde_i_po =
+        realized && full[i] ? realized->f_tilde_i_aig[i] : nullptr;
+    out << i << ";" << Abc_ObjName(f_i_aig[i]) << ";"
+        << CandidateStatus(p, a, i, candidate[i]) << ";"
+        << a.f_tilde.hamming_distances[i] << ";"
+        << a.f_tilde.hamming_distances[i] / n_exp << ";" << a.e_i[i] << ";";
+    if (a.HasBlocks())
+      out << a.e_block_i[i] << ";";
+    else
+      out << "-;";
+    out << bdd::BDDs{{a.f_bdd.components[i]}}.Count() << ";"
+        << bdd::BDDs{{a.f_tilde_bdds.components[i]}}.Count() << ";"
+        << aig::CountNodesFor({f_i_aig[i]}) << ";";
+    if (f_tilde_i_po)
+      out << aig::CountNodesFor({f_tilde_i_po}) << ";";
+    else
+      out << "-;";
+    out << profit[i] << ";" << block_profit[i];
+    // Profits of the other metrics are only evaluated for f_tilde candidates,
+    // the level based ones only if f_tilde_i is realized
+    for (auto &metric : ProfitMetrics::BY_NAME) {
+      out << ";";
+      bool needs_level =
+          metric.first == "delay" || metric.first == "areadelay";
+      if (full[i] && (f_tilde_i_po || !needs_level))
+        out << metric.second({.i = i,
+                              .f_i_po = f_i_aig[i],
+                              .f_tilde_i_po = f_tilde_i_po,
+                              .f_i_bdd = a.f_bdd.components[i],
+                              .f_tilde_i_bdd = a.f_tilde_bdds.components[i]});
+      else
+        out << "-";
+    }
+    out << ";" << selection[i] << ";" << ToSeconds(a.t_profit[i]) << "\n";
+  }
+}
+
+static SymmetrizationResult
+Estimate(const ComponentwiseSymmetrizationParameters &p,
+         utils::Report &report) {
+  // The global BDDs stay attached to the network
+  report.StartPhase("symm");
+  Approximation a = Approximate(p, aig::GetGlobalBDD(p.ntk));
+  report.EndPhase();
+  Abc_PrintTime(ABC_VERBOSE, "t_symm", a.t_symm);
+  Abc_PrintTime(ABC_VERBOSE, "t_bdd", a.t_bdd);
+
+  // Profit metrics are evaluated without AIG POs for f_tilde
+  report.StartPhase("select");
+  auto f_i_aig = aig::GetPOs(p.ntk);
+  auto profits = ComputeProfits(p.profit_metric, a, f_i_aig, nullptr);
+  auto selection = SelectComponents(p, a, profits);
+  if (!p.diagnostics_file.empty()) {
+    WriteDiagnostics(p, a, f_i_aig, nullptr, profits, selection);
+  }
+
+  aig::Signals kept;
+  for (size_t i = 0; i < a.m; i++) {
+    if (!selection.selection[i] && !selection.block[i])
+      kept.push_back(f_i_aig[i]);
+  }
+  size_t bdd_size_before = a.f_bdd.Count();
+  auto f_hat_bdd = SelectBDDs(a, selection);
+  size_t bdd_size_after = f_hat_bdd.Count();
+  report.EndPhase();
+
+  SymmetrizationResult result;
+  result.t_symm = ToSeconds(a.t_symm);
+  result.t_bdd = ToSeconds(a.t_bdd);
+  result.aig_size_before = Abc_NtkNodeNum(p.ntk);
+  result.aig_size_after = aig::CountNodesFor(kept);
+  result.bdd_size_before = bdd_size_before;
+  result.bdd_size_after = bdd_size_after;
+  result.selection = ToString(selection);
+  result.error = selection.weight;
+  ReportResult(report, result, a, selection);
+  report.SetFlag("dry_run", true);
+  ReportBDDs(report, a.f_bdd.GetManager());
+
+  Abc_Print(ABC_STANDARD, "Estimation complete (network unchanged).\n");
+  Abc_Print(ABC_STANDARD, "AIG size of unselected components: %zu of %zu\n",
+            result.aig_size_after, result.aig_size_before);
+  Abc_Print(ABC_STANDARD, "BDD size: %zu -> %zu (%.2f%%)\n", bdd_size_before,
+            bdd_size_after,
+            100.0 * ((double)bdd_size_before - bdd_size_after) /
+                bdd_size_before);
+  PrintSelection(selection);
+  PrintCandidates(a);
+  PrintKnapsack(selection);
+  PrintBlocks(a);
+  PrintPolarity(a);
+  PrintWordError(p, a.f_bdd, f_hat_bdd);
+  return result;
+}
+
+// True iff the metric is one of the cheap ones that only count BDD nodes
+static bool IsCheap(const ProfitMetric &metric) {
+  auto f = metric.target<Profit (*)(ProfitMetricParameters)>();
+  return f && (*f == ProfitMetrics::Constant ||
+               *f == ProfitMetrics::BddSizeDifference);
+}
+
+static bool IsConstant(const ProfitMetric &metric) {
+  auto f = metric.target<Profit (*)(ProfitMetricParameters)>();
+  return f && *f == ProfitMetrics::Constant;
+}
+
+static void PrintBudget(const utils::Budget &budget,
+                        const std::vector<std::string> &degradations) {
+  if (!degradations.empty()) {
+    std::string txt;
+    for (auto &d : degradations) {
+      txt += (txt.empty() ? "" : ", ") + d;
+    }
+    Abc_Print(ABC_STANDARD, "Degraded: %s\n", txt.c_str());
+  }
+  if (budget.IsLimited() || !degradations.empty()) {
+    Abc_Print(ABC_STANDARD, "Budget: %s\n", budget.Report().c_str());
+  }
+}
+
+// +----------------------------------------------------------+
+// |                         Sharded                          |
+// +----------------------------------------------------------+
+
+// Result of a shard for one of its components
+struct ShardComponent {
+  size_t i;
+  bool exact, candidate;
+  double e_i;
+  ValueCount hamming_distance;
+  // Node counts of f_i and f_tilde_i on their own
+  size_t f_i_size, f_tilde_i_size;
+  // Only meaningful for candidates and cheap profit metrics
+  Profit profit;
+  ValueVector value_vector;
+};
+
+// Runs within the worker: builds the BDDs of the given POs and approximates
+// them. Returns one line per component (see ShardComponent).
+static std::string
+ApproximateShard(const ComponentwiseSymmetrizationParameters &p,
+                 const std::vector<int> &pos) {
+  aig::GlobalBDDParameters bdd_param;
+  bdd_param.reorder = CUDD_REORDER_SYMM_SIFT;
+  std::unique_ptr<DdManager, void (*)(DdManager *)> mgr(
+      aig::CreateManager(p.ntk, bdd_param), Cudd_Quit);
+  std::ostringstream out;
+  out.precision(std::numeric_limits<double>::max_digits10);
+  {
+    // The error factors depend on the index among all POs
+    auto q = p;
+    size_t m = Abc_NtkPoNum(p.ntk);
+    q.factors = [&](size_t, size_t c) { return p.factors(m, pos[c]); };
+    Approximation a =
+        Approximate(q, aig::BuildBDDs(p.ntk, pos, mgr.get(), bdd_param));
+
+    std::vector<bool> candidate(a.m, false);
+    std::vector<Profit> profit(a.m, 0);
+    if (IsCheap(p.profit_metric)) {
+      auto profits = ComputeProfits(p.profit_metric, a,
+                                    aig::Signals(a.m, nullptr), nullptr);
+      for (size_t c = 0; c < a.candidates.size(); c++) {
+        profit[a.candidates[c]] = profits.full[c];
+      }
+    }
+    for (size_t i : a.candidates) {
+      candidate[i] = true;
+    }
+    for (size_t i = 0; i < a.m; i++) {
+      out << pos[i] << " " << a.exact[i] << " " << candidate[i] << " "
+          << a.e_i[i] << " " << a.f_tilde.hamming_distances[i] << " "
+          << bdd::BDDs{{a.f_bdd.components[i]}}.Count() << " "
+          << bdd::BDDs{{a.f_tilde_bdds.components[i]}}.Count() << " "
+          << profit[i] << " " << tt::ToString(a.f_tilde.components[i])
+          << "\n";
+    }
+  }
+  return out.str();
+}
+
+static std::vector<ShardComponent> ParseShard(const std::string &output) {
+  std::vector<ShardComponent> components;
+  std::istringstream in(output);
+  ShardComponent c;
+  std::string value_vector;
+  while (in >> c.i >> c.exact >> c.candidate >> c.e_i >> c.hamming_distance >>
+         c.f_i_size >> c.f_tilde_i_size >> c.profit >> value_vector) {
+    c.value_vector.clear();
+    for (char v : value_vector) {
+      c.value_vector.push_back(v == '1');
+    }
+    components.push_back(c);
+  }
+  return components;
+}
+
+static void CheckShardable(const ComponentwiseSymmetrizationParameters &p) {
+  if (p.ntk == nullptr || !Abc_NtkIsStrash(p.ntk)) {
+    throw std::invalid_argument("given network is not an AIG");
+  }
+  if (Abc_NtkCiNum(p.ntk) != Abc_NtkPiNum(p.ntk)) {
+    throw std::invalid_argument("symmetrization does only support "
+                                "combinatorial logic");
+  }
+  if (!p.blocks.empty() || p.joint_error_rate || p.word_error_metric ||
+      p.polarity_search || p.time_budget || p.memory_budget ||
+      !p.checkpoint_directory.empty() || p.dry_run ||
+      !p.diagnostics_file.empty()) {
+    throw std::invalid_argument(
+        "sharded symmetrization does not support blocks, joint error rates, "
+        "word error metrics, polarity search, budgets, checkpoints, dry "
+        "runs or diagnostics");
+  }
+}
+
+// Symmetrizes the network with the POs split into shards, see
+// ComponentwiseSymmetrizationParameters::shards
+static SymmetrizationResult
+SymmetrizeSharded(ComponentwiseSymmetrizationParameters p,
+                  utils::Report &report) {
+  CheckShardable(p);
+  size_t aig_size_before = Abc_NtkNodeNum(p.ntk);
+  size_t depth_before = Abc_NtkLevel(p.ntk);
+
+  // Approximate the shards in parallel
+  utils::Span shards_span("shards");
+  report.StartPhase("symm");
+  auto t_start = Abc_Clock();
+  auto groups = aig::PartitionCOs(p.ntk, p.shards);
+  size_t n_workers =
+      p.shard_workers ? p.shard_workers : utils::HardwareConcurrency();
+  auto results = utils::RunForked(groups.size(), n_workers, [&](size_t g) {
+    return ApproximateShard(p, groups[g]);
+  });
+
+  Approximation a;
+  a.n = Abc_NtkPiNum(p.ntk);
+  a.m = Abc_NtkPoNum(p.ntk);
+  a.f_tilde = {.n = a.n,
+               .m = a.m,
+               .components = std::vector<ValueVector>(a.m),
+               .hamming_distances = std::vector<ValueCount>(a.m, 0)};
+  a.e_i.assign(a.m, 0);
+  a.exact.assign(a.m, false);
+  std::vector<Profit> shard_profits(a.m, 0);
+  size_t bdd_size_before = 0;
+  std::vector<size_t> f_tilde_i_sizes(a.m, 0), f_i_sizes(a.m, 0);
+  for (size_t g = 0; g < groups.size(); g++) {
+    auto components = ParseShard(results[g].output);
+    if (results[g].status != utils::ForkedResult::Status::SUCCESS ||
+        components.size() != groups[g].size()) {
+      throw std::runtime_error("shard " + std::to_string(g) + " failed");
+    }
+    for (auto &c : components) {
+      a.f_tilde.components[c.i] = c.value_vector;
+      a.f_tilde.hamming_distances[c.i] = c.hamming_distance;
+      a.e_i[c.i] = c.e_i;
+      a.exact[c.i] = c.exact;
+      shard_profits[c.i] = c.profit;
+      f_i_sizes[c.i] = c.f_i_size;
+      f_tilde_i_sizes[c.i] = c.f_tilde_i_size;
+      bdd_size_before += c.f_i_size;
+      if (c.candidate)
+        a.candidates.push_back(c.i);
+    }
+  }
+  std::sort(a.candidates.begin(), a.candidates.end());
+  // Stale after rewiring, kept until all shards have succeeded
+  if (aig::HasGlobalBDD(p.ntk)) {
+    Abc_NtkFreeGlobalBdds(p.ntk, 1);
+  }
+  a.t_symm = Abc_Clock() - t_start;
+  a.t_bdd = 0;
+  report.EndPhase();
+  shards_span.Stop();
+  Abc_PrintTime(ABC_VERBOSE, "t_symm", a.t_symm);
+
+  // Realize and optimize all candidates at once
+  SymmetrizationResult result;
+  report.StartPhase("aig");
+  t_start = Abc_Clock();
+  aig::AddSymmetricPOs(p.ntk, CandidateFunction(a));
   if (p.frame && !p.optimization_command.empty()) {
+    utils::Span optimize_span("optimize");
+    optimize_span.Arg("aig_size", Abc_NtkNodeNum(p.ntk));
     Cmd_CommandExecute(p.frame, p.optimization_command.c_str());
     p.ntk = Abc_FrameReadNtk(p.frame);
+    optimize_span.Arg("optimized_aig_size", Abc_NtkNodeNum(p.ntk));
   }
+  Abc_NtkLevel(p.ntk);
+  report.EndPhase();
+  result.t_aig = ToSeconds(Abc_Clock() - t_start);
   Abc_PrintTime(ABC_VERBOSE, "t_aig", Abc_Clock() - t_start);
 
-  // Compute BDDs of f_tilde
+  // Cheap profits come from the shards, the others are evaluated on the AIG
+  report.StartPhase("select");
   t_start = Abc_Clock();
-  auto f_tilde_bdds = bdd::Create(f_bdd.GetManager(), f_tilde);
-  Abc_PrintTime(ABC_VERBOSE, "t_bdd", Abc_Clock() - t_start);
+  auto realized = GetRealizedPOs(p.ntk, a);
+  Profits profits;
+  bdd::BDD none;
+  for (size_t i : a.candidates) {
+    profits.full.push_back(
+        IsCheap(p.profit_metric)
+            ? shard_profits[i]
+            : p.profit_metric({.i = i,
+                               .f_i_po = realized.f_i_aig[i],
+                               .f_tilde_i_po = realized.f_tilde_i_aig[i],
+                               .f_i_bdd = none,
+                               .f_tilde_i_bdd = none}));
+  }
+  auto selection = SelectComponents(p, a, profits);
+  RewirePOs(p.ntk, realized, selection);
+  if (!aig::CleanupAndCheck(p.ntk)) {
+    throw std::logic_error("network check after symmetrization failed");
+  }
+  report.EndPhase();
+  result.t_select = ToSeconds(Abc_Clock() - t_start);
+  Abc_PrintTime(ABC_VERBOSE, "t_select", Abc_Clock() - t_start);
 
-  // Retrieve POs for components of f and f_tilde after potential optimization
-  t_start = Abc_Clock();
-  auto [f_i_aig, f_tilde_i_aig] = utils::Split(aig::GetPOs(p.ntk));
+  size_t bdd_size_after = 0;
+  for (size_t i = 0; i < a.m; i++) {
+    bdd_size_after +=
+        selection.selection[i] ? f_tilde_i_sizes[i] : f_i_sizes[i];
+  }
+  size_t aig_size_after = Abc_NtkNodeNum(p.ntk);
+  size_t depth_after = Abc_NtkLevel(p.ntk);
 
-  // Compute profits
-  std::vector<Profit> profits(m);
-  for (size_t i = 0; i < m; i++) {
-    profits[i] = p.profit_metric({.i = i,
-                                  .f_i_po = f_i_aig[i],
-                                  .f_tilde_i_po = f_tilde_i_aig[i],
-                                  .f_i_bdd = f_bdd.components[i],
-                                  .f_tilde_i_bdd = f_tilde_bdds.components[i]});
+  // BDD sizes are sums over the components, as no shard has all of them
+  Abc_Print(ABC_STANDARD, "Symmetrization complete.\n");
+  Abc_Print(ABC_STANDARD, "AIG size: %zu -> %zu (%.2f%%)\n", aig_size_before,
+            aig_size_after,
+            100.0 * ((double)aig_size_before - aig_size_after) /
+                aig_size_before);
+  Abc_Print(ABC_STANDARD,
+            "BDD size: %zu -> %zu (%.2f%%) (sum over components)\n",
+            bdd_size_before, bdd_size_after,
+            100.0 * ((double)bdd_size_before - bdd_size_after) /
+                bdd_size_before);
+  PrintSelection(selection);
+  PrintCandidates(a);
+  PrintKnapsack(selection);
+  Abc_Print(ABC_STANDARD, "Depth: %zu -> %zu\n", depth_before, depth_after);
+  std::string sizes;
+  for (auto &group : groups) {
+    sizes += (sizes.empty() ? "" : ", ") + std::to_string(group.size());
   }
+  Abc_Print(ABC_STANDARD, "Shards: %zu (%s POs)\n", groups.size(),
+            sizes.c_str());
 
-  // Compute e_i
-  std::vector<double> e_i = f_tilde.hamming_distances;
-  double n_exp = exp2(n);
-  for (size_t i = 0; i < m; i++) {
-    e_i[i] *= p.factors(m, i) / n_exp;
+  result.t_symm = ToSeconds(a.t_symm);
+  result.aig_size_before = aig_size_before;
+  result.aig_size_after = aig_size_after;
+  result.bdd_size_before = bdd_size_before;
+  result.bdd_size_after = bdd_size_after;
+  result.selection = ToString(selection);
+  result.error = selection.weight;
+  ReportResult(report, result, a, selection);
+  report.Set("depth_before", depth_before);
+  report.Set("depth_after", depth_after);
+  report.Set("shards", groups.size());
+  return result;
+}
+
+SymmetrizationResult Symmetrize(ComponentwiseSymmetrizationParameters p) {
+  // TODO: keep names
+  utils::Span span("Symmetrize");
+  utils::Report unused_report;
+  utils::Report &report = p.report ? *p.report : unused_report;
+  bdd::ResetCacheStatistics();
+  if (p.shards > 1) {
+    return SymmetrizeSharded(p, report);
+  }
+  CheckNetwork(p.ntk);
+  if (p.dry_run) {
+    return Estimate(p, report);
   }
+  SymmetrizationResult result;
 
-  // Solve knapsack problem
-  auto [error, sigma] = p.knapsack_solver.Solve(e_i, profits, p.error_bound);
+  // Shares of the time budget: the phases may run until these fractions of
+  // the budget have elapsed
+  const double SYMM_UNTIL = 0.4, AIG_UNTIL = 0.8;
+  utils::Budget budget(p.time_budget, p.memory_budget);
+  utils::InterruptHandler interrupt_handler;
+  std::vector<std::string> degradations;
 
-  // delete old POs and add new ones for f_hat
-  auto f_hat_aig = utils::Select(f_tilde_i_aig, f_i_aig, sigma);
-  for (auto &obj : f_hat_aig) {
-    obj = Abc_ObjFanin(obj, 0);
+  // Retrieve BDD from network and take ownership of manager
+  std::unique_ptr<DdManager, void (*)(DdManager *)> mgr_ptr(
+      (DdManager *)Abc_NtkGlobalBddMan(p.ntk), Cudd_Quit);
+  DdManager *mgr = mgr_ptr.get();
+  auto f_bdd = aig::GetGlobalBDD(p.ntk);
+  Abc_NtkFreeGlobalBdds(p.ntk, 0);
+
+  size_t aig_size_before = Abc_NtkNodeNum(p.ntk);
+  size_t bdd_size_before = f_bdd.Count();
+  size_t depth_before = Abc_NtkLevel(p.ntk);
+
+  std::optional<Checkpoint> checkpoint;
+  std::vector<std::string> resumed;
+  if (!p.checkpoint_directory.empty()) {
+    if (p.frame == nullptr) {
+      throw std::invalid_argument("checkpoints require a frame");
+    }
+    checkpoint.emplace(p.checkpoint_directory, p.resume, aig::Hash(p.ntk),
+                       bdd::Hash(f_bdd), p.checkpoint_settings);
+    if (checkpoint->HasFunctions())
+      resumed.push_back("symm");
+  }
+  const Checkpoint *cp = checkpoint ? &*checkpoint : nullptr;
+
+  budget.StartPhase("symm", SYMM_UNTIL);
+  report.StartPhase("symm");
+  Approximation a = Approximate(p, std::move(f_bdd), cp);
+  budget.EndPhase(Cudd_ReadMemoryInUse(mgr));
+  report.EndPhase();
+  Abc_PrintTime(ABC_VERBOSE, "t_symm", a.t_symm);
+
+  // Add POs for the candidates of f_tilde and f_block to AIG
+  budget.StartPhase("aig", AIG_UNTIL);
+  report.StartPhase("aig");
+  auto t_start = Abc_Clock();
+  // Degraded phases are not checkpointed, so that resuming with a larger
+  // budget recomputes them
+  bool degraded_aig = false;
+  if (cp && cp->HasAIG()) {
+    p.ntk = cp->LoadAIG(p.frame);
+    resumed.push_back("aig");
+    if (Abc_NtkPoNum(p.ntk) !=
+        a.m + a.candidates.size() + a.block_candidates.size()) {
+      throw std::invalid_argument("AIG of checkpoint does not match the "
+                                  "candidates");
+    }
+  } else {
+    aig::AddSymmetricPOs(p.ntk, CandidateFunction(a));
+    if (a.HasBlocks()) {
+      aig::AddBlockSymmetricPOs(p.ntk, CandidateBlockFunction(a));
+    }
+
+    // Optimize unless the previous phase already ran short
+    bool short_of_budget = budget.PhaseExceeded() || utils::Interrupted() ||
+                           budget.MemoryExceeded(Cudd_ReadMemoryInUse(mgr));
+    if (p.frame && !p.optimization_command.empty() && short_of_budget) {
+      degradations.push_back("skipped optimization");
+      degraded_aig = true;
+    } else if (p.frame && !p.optimization_command.empty()) {
+      utils::Span optimize_span("optimize");
+      optimize_span.Arg("aig_size", Abc_NtkNodeNum(p.ntk));
+      Cmd_CommandExecute(p.frame, p.optimization_command.c_str());
+      p.ntk = Abc_FrameReadNtk(p.frame);
+      optimize_span.Arg("optimized_aig_size", Abc_NtkNodeNum(p.ntk));
+    }
+    if (cp && !degraded_aig)
+      cp->SaveAIG(p.frame);
+  }
+  // Levels of the doubled network, read by the delay profit metrics
+  Abc_NtkLevel(p.ntk);
+  budget.EndPhase(Cudd_ReadMemoryInUse(mgr));
+  report.EndPhase();
+  result.t_aig = ToSeconds(Abc_Clock() - t_start);
+  Abc_PrintTime(ABC_VERBOSE, "t_aig", Abc_Clock() - t_start);
+  Abc_PrintTime(ABC_VERBOSE, "t_bdd", a.t_bdd);
+
+  // Retrieve POs for components of f and f_tilde after potential optimization
+  budget.StartPhase("select", 1);
+  report.StartPhase("select");
+  t_start = Abc_Clock();
+  auto realized = GetRealizedPOs(p.ntk, a);
+
+  // Fall back to cheaper profit metrics if running short
+  auto metric = p.profit_metric;
+  size_t n_degradations = degradations.size();
+  bool exhausted =
+      budget.Exhausted() || budget.MemoryExceeded(Cudd_ReadMemoryInUse(mgr));
+  if (exhausted && !IsConstant(metric)) {
+    metric = ProfitMetrics::Constant;
+    degradations.push_back("const profit metric");
+  } else if (budget.TimeExceeded(AIG_UNTIL) && !IsCheap(metric)) {
+    metric = ProfitMetrics::BddSizeDifference;
+    degradations.push_back("bdd profit metric");
+  }
+
+  // Compute profits and solve knapsack problem
+  size_t n_candidates = a.candidates.size() + a.block_candidates.size();
+  Profits profits;
+  if (cp && cp->HasProfits()) {
+    cp->LoadProfits(profits.full, profits.block);
+    resumed.push_back("profits");
+    if (profits.full.size() > a.candidates.size() ||
+        profits.block.size() > a.block_candidates.size()) {
+      throw std::invalid_argument("profits of checkpoint do not match the "
+                                  "candidates");
+    }
+    a.candidates.resize(profits.full.size());
+    a.block_candidates.resize(profits.block.size());
+  } else {
+    // The constant metric costs nothing, hence all candidates are evaluated
+    // even if it is the fallback of an exhausted budget
+    profits = ComputeProfits(metric, a, realized.f_i_aig, &realized,
+                             IsConstant(metric) ? nullptr : &budget);
+    // Profits on a degraded AIG, of a fallback metric or of only some
+    // candidates are not saved
+    bool complete =
+        a.candidates.size() + a.block_candidates.size() == n_candidates;
+    if (cp && !degraded_aig && degradations.size() == n_degradations &&
+        complete)
+      cp->SaveProfits(profits.full, profits.block);
+  }
+  size_t n_evaluated = a.candidates.size() + a.block_candidates.size();
+  if (n_evaluated < n_candidates) {
+    degradations.push_back("selected among " + std::to_string(n_evaluated) +
+                           " of " + std::to_string(n_candidates) +
+                           " candidates");
   }
-  while (Abc_NtkPoNum(p.ntk) != 0) {
-    Abc_NtkDeleteObj(Abc_NtkPo(p.ntk, 0));
+  auto selection = SelectComponents(p, a, profits);
+  if (!p.diagnostics_file.empty()) {
+    WriteDiagnostics(p, a, realized.f_i_aig, &realized, profits, selection);
   }
-  aig::AddPOs(p.ntk, f_hat_aig);
+
+  // delete old POs and add new ones for f_hat
+  RewirePOs(p.ntk, realized, selection);
 
   // Compute new BDD and set
-  auto f_hat_bdd = bdd::BDDs::Select(f_tilde_bdds, f_bdd, sigma);
+  auto f_hat_bdd = SelectBDDs(a, selection);
   aig::SetGlobalBDDs(p.ntk, f_hat_bdd);
   mgr_ptr.release();
+  result.t_select = ToSeconds(Abc_Clock() - t_start);
   Abc_PrintTime(ABC_VERBOSE, "t_select", Abc_Clock() - t_start);
 
   // cleanup and check
   if (!aig::CleanupAndCheck(p.ntk)) {
     throw std::logic_error("network check after symmetrization failed");
   }
+  budget.EndPhase(Cudd_ReadMemoryInUse(mgr));
+  report.EndPhase();
+  if (utils::Interrupted()) {
+    degradations.push_back("interrupted");
+  }
 
   size_t aig_size_after = Abc_NtkNodeNum(p.ntk);
   size_t bdd_size_after = f_hat_bdd.Count();
+  size_t depth_after = Abc_NtkLevel(p.ntk);
 
-  Abc_Print(ABC_STANDARD, "Symmetrization complete.\n", error);
+  Abc_Print(ABC_STANDARD, "Symmetrization complete.\n");
   Abc_Print(ABC_STANDARD, "AIG size: %u -> %u (%.2f%%)\n", aig_size_before,
             aig_size_after,
             100.0 * ((double)aig_size_before - aig_size_after) /
@@ -184,15 +1419,153 @@ void Symmetrize(ComponentwiseSymmetrizationParameters p) {
             bdd_size_after,
             100.0 * ((double)bdd_size_before - bdd_size_after) /
                 bdd_size_before);
-  size_t n_sigma = 0;
-  for (auto e : sigma) {
-    if (e) {
-      n_sigma++;
+  PrintSelection(selection);
+  PrintCandidates(a);
+  PrintKnapsack(selection);
+  PrintBlocks(a);
+  PrintPolarity(a);
+  Abc_Print(ABC_STANDARD, "Depth: %zu -> %zu\n", depth_before, depth_after);
+  PrintWordError(p, a.f_bdd, f_hat_bdd);
+  PrintBudget(budget, degradations);
+  if (cp) {
+    std::string txt;
+    for (auto &phase : resumed) {
+      txt += (txt.empty() ? "" : ", ") + phase;
     }
+    Abc_Print(ABC_STANDARD, "Checkpoint: %s (resumed: %s)\n",
+              p.checkpoint_directory.c_str(),
+              txt.empty() ? "none" : txt.c_str());
   }
-  Abc_Print(ABC_STANDARD, "Selection: %s (%.2f%% of components)\n",
-            tt::ToString(sigma).c_str(), 100.0 * n_sigma / sigma.size());
-  Abc_Print(ABC_STANDARD, "Total error: %.2f\n", error);
+
+  result.t_symm = ToSeconds(a.t_symm);
+  result.t_bdd = ToSeconds(a.t_bdd);
+  result.aig_size_before = aig_size_before;
+  result.aig_size_after = aig_size_after;
+  result.bdd_size_before = bdd_size_before;
+  result.bdd_size_after = bdd_size_after;
+  result.selection = ToString(selection);
+  result.error = selection.weight;
+  ReportResult(report, result, a, selection);
+  report.Set("depth_before", depth_before);
+  report.Set("depth_after", depth_after);
+  report.Set("degradations", degradations);
+  report.Set("resumed", resumed);
+  ReportBDDs(report, mgr);
+  return result;
+}
+
+// +----------------------------------------------------------+
+// |                          Sweep                           |
+// +----------------------------------------------------------+
+
+static bool Dominates(const SweepPoint &a, const SweepPoint &b) {
+  bool no_worse = a.error <= b.error && a.aig_size <= b.aig_size &&
+                  a.bdd_size <= b.bdd_size && a.depth <= b.depth;
+  bool better = a.error < b.error || a.aig_size < b.aig_size ||
+                a.bdd_size < b.bdd_size || a.depth < b.depth;
+  return no_worse && better;
+}
+
+static void MarkParetoFront(std::vector<SweepPoint> &points) {
+  for (auto &point : points) {
+    point.pareto_optimal = true;
+    for (auto &other : points) {
+      if (Dominates(other, point)) {
+        point.pareto_optimal = false;
+        break;
+      }
+    }
+  }
+}
+
+std::vector<SweepPoint> Sweep(const SweepParameters &p) {
+  CheckNetwork(p.base.ntk);
+  if (p.error_bounds.empty() || p.profit_metrics.empty()) {
+    throw std::invalid_argument("no error bounds or profit metrics given");
+  }
+  if (p.materialize && p.base.frame == nullptr) {
+    throw std::invalid_argument("materializing a point requires a frame");
+  }
+  if (!p.base.blocks.empty()) {
+    throw std::invalid_argument("sweep does not support block symmetrization");
+  }
+  // Candidates are selected with respect to the largest error bound
+  ComponentwiseSymmetrizationParameters q = p.base;
+  q.error_bound = *std::max_element(p.error_bounds.begin(),
+                                    p.error_bounds.end());
+
+  // The symmetric POs are added to a copy, the original network and its
+  // global BDDs stay untouched
+  Abc_Ntk_t *doubled = Abc_NtkDup(q.ntk);
+  std::vector<SweepPoint> points;
+  bdd::BDDs f_hat_bdd;
+  try {
+    Approximation a = Approximate(q, aig::GetGlobalBDD(q.ntk));
+    Abc_PrintTime(ABC_VERBOSE, "t_symm", a.t_symm);
+
+    auto t_start = Abc_Clock();
+    aig::AddSymmetricPOs(doubled, CandidateFunction(a));
+    if (q.frame && !q.optimization_command.empty()) {
+      // ExecuteOn deletes doubled if the command replaces or fails on it
+      Abc_Ntk_t *input = std::exchange(doubled, nullptr);
+      doubled = aig::ExecuteOn(q.frame, input, q.optimization_command);
+    }
+    Abc_NtkLevel(doubled);
+    Abc_PrintTime(ABC_VERBOSE, "t_aig", Abc_Clock() - t_start);
+    Abc_PrintTime(ABC_VERBOSE, "t_bdd", a.t_bdd);
+
+    t_start = Abc_Clock();
+    auto realized = GetRealizedPOs(doubled, a);
+    for (auto &[name, metric] : p.profit_metrics) {
+      auto profits = ComputeProfits(metric, a, realized.f_i_aig, &realized);
+      for (double bound : p.error_bounds) {
+        q.error_bound = bound;
+        auto selection = SelectComponents(q, a, profits);
+        auto f_hat_aig = SelectPOs(realized, selection);
+        size_t aig_size = aig::CountNodesFor(f_hat_aig);
+        size_t bdd_size = SelectBDDs(a, selection).Count();
+        points.push_back({.profit_metric = name,
+                          .error_bound = bound,
+                          .error = selection.weight,
+                          .selection = selection.selection,
+                          .gap = selection.Gap(),
+                          .aig_size = aig_size,
+                          .bdd_size = bdd_size,
+                          .depth = aig::MaxLevel(f_hat_aig)});
+      }
+    }
+    MarkParetoFront(points);
+    Abc_PrintTime(ABC_VERBOSE, "t_select", Abc_Clock() - t_start);
+
+    if (p.materialize) {
+      if (*p.materialize >= points.size()) {
+        throw std::invalid_argument("no sweep point with the given index");
+      }
+      Selection selection;
+      selection.selection = points[*p.materialize].selection;
+      selection.block.assign(a.m, false);
+      RewirePOs(doubled, realized, selection);
+      f_hat_bdd = SelectBDDs(a, selection)
+                      .Transfer(bdd::NewManager(a.f_bdd.GetManager()));
+    }
+  } catch (...) {
+    if (doubled)
+      Abc_NtkDelete(doubled);
+    throw;
+  }
+
+  if (!p.materialize) {
+    Abc_NtkDelete(doubled);
+    return points;
+  }
+  if (!aig::CleanupAndCheck(doubled)) {
+    Abc_NtkDelete(doubled);
+    throw std::logic_error("network check after symmetrization failed");
+  }
+  aig::SetGlobalBDDs(doubled, f_hat_bdd);
+  f_hat_bdd = {};
+  Abc_FrameReplaceCurrentNetwork(q.frame, doubled);
+  return points;
 }
 
 } // namespace symmetrize
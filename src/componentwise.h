@@ -1,14 +1,18 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <optional>
 
 #include "includes.h"
 #include "wae_factors.h"
 
 #include "bdd/bdd.h"
+#include "bdd/word.h"
 
 #include "utils/knapsack.h"
 #include "utils/maths.h"
+#include "utils/report.h"
 
 namespace symmetrize {
 
@@ -23,17 +27,33 @@ struct ProfitMetricParameters {
 };
 
 // Given i, o and bdd, returns the profit of selecting the component f_i with
-// PO o and BDD bdd
+// PO o and BDD bdd. The POs of f_tilde are nullptr during dry runs.
 using ProfitMetric = std::function<Profit(ProfitMetricParameters)>;
 
 extern utils::GreedyApproximateKnapsackSolver<double, Profit> DEFAULT_SOLVER;
 
+struct KnapsackSolvers {
+  // greedy, bnb (branch and bound) and dp (dynamic programming)
+  static std::vector<std::string> NAMES;
+
+  // Creates the solver with the given name. The time limit in seconds only
+  // applies to the branch and bound solver (0 means no limit).
+  static std::unique_ptr<utils::KnapsackSolver<double, Profit>>
+  Create(const std::string &name, double time_limit = 0);
+};
+
 struct ProfitMetrics {
   static std::map<std::string, ProfitMetric> BY_NAME;
 
   static Profit AigSizeDifference(ProfitMetricParameters p);
   static Profit BddSizeDifference(ProfitMetricParameters p);
   static Profit Constant(ProfitMetricParameters p);
+  // Difference of the AIG levels of f_i and f_tilde_i. Requires the levels
+  // of the network to be up to date.
+  static Profit LevelDifference(ProfitMetricParameters p);
+
+  // AIG size difference plus delay_weight times the level difference
+  static ProfitMetric AreaDelay(double delay_weight);
 };
 
 struct ComponentwiseSymmetrizationParameters {
@@ -43,16 +63,163 @@ struct ComponentwiseSymmetrizationParameters {
   WAEFactorFunction factors;
   double error_bound = 0;
 
+  // Components whose BDD size difference between f_i and f_tilde_i is below
+  // this value are not realized in the AIG and never selected
+  std::optional<Profit> min_bdd_profit;
+
   ProfitMetric profit_metric;
-  const utils::KnapsackSolver<double, Profit> &knapsack_solver = DEFAULT_SOLVER;
+  const utils::KnapsackSolver<double, Profit> *knapsack_solver =
+      &DEFAULT_SOLVER;
 
   std::string optimization_command;
+
+  // Blocks of inputs for partial symmetrization. If given, every component
+  // may also be replaced by its nearest function that is symmetric within
+  // each block; the choice between the original, block symmetric and fully
+  // symmetric component is a multiple-choice knapsack problem (solved
+  // greedily, independent of knapsack_solver).
+  InputBlocks blocks;
+
+  // Probability of each PI to be one. If given, errors are expected values
+  // under this distribution (assuming independent inputs) instead of uniformly
+  // distributed inputs.
+  std::vector<double> input_probabilities;
+
+  // Selects components such that the exact joint error rate, i.e., the
+  // percentage of inputs on which any selected component differs, stays
+  // within the error bound (instead of the sum of the component errors).
+  // The factors only affect the preselection of candidates.
+  bool joint_error_rate = false;
+
+  // If set, f_tilde is the symmetric function minimizing the given numeric
+  // error of the output word (PO i has weight 2^i) instead of the
+  // componentwise nearest one. The selection still bounds the sum of the
+  // component errors, which for awae is an upper bound on the MAE of the
+  // word.
+  std::optional<bdd::WordErrorMetric> word_error_metric;
+
+  // Searches for input polarities such that f is closer to a symmetric
+  // function in the complemented inputs (e.g. subtractors or comparators).
+  // Not supported together with input probabilities or word error metrics.
+  bool polarity_search = false;
+
+  // Wall clock budget in seconds and memory budget of the BDD manager in
+  // bytes (0 means unlimited). When running short, the run degrades instead
+  // of failing: the optimization command is skipped, the profit metric falls
+  // back to bdd or const and only candidates whose profit has been evaluated
+  // are selected. SIGINT is treated like an exhausted time budget, i.e., the
+  // current phase is finished and a valid partial result is returned. The
+  // memory budget is a soft limit checked between the phases, as CUDD fails
+  // hard once its own limit (Cudd_SetMaxMemory) is reached.
+  double time_budget = 0;
+  size_t memory_budget = 0;
+
+  // Directory to write a checkpoint to after each phase (see Checkpoint).
+  // If resume is set, the phases completed in the checkpoint are skipped,
+  // which requires the network, its global BDDs and the settings to be the
+  // same as when the checkpoint was written.
+  std::string checkpoint_directory;
+  bool resume = false;
+  // Options of the run that the checkpoint depends on
+  std::string checkpoint_settings;
+
+  // If larger than 1, the POs are split into this many groups of similar
+  // cone size, each of which is approximated by a forked worker process that
+  // builds only the BDDs of its cones in a manager of its own. The workers
+  // send back their value vectors, errors and (for const and bdd) profits;
+  // the optimization, the knapsack problem and the rewiring happen once for
+  // the whole network. The global BDDs are not needed and not set
+  // afterwards. Not supported together with blocks, joint error rates, word
+  // error metrics, polarity search, budgets, checkpoints, dry runs or
+  // diagnostics.
+  size_t shards = 1;
+  // Maximum number of shard processes running at once, 0 means one per
+  // hardware thread
+  size_t shard_workers = 0;
+
+  // If given, receives the wall and CPU time and resident set size of each
+  // phase, the statistics of the BDD manager and the C_H tables, the sizes
+  // before and after and the full selection and error
+  utils::Report *report = nullptr;
+
+  // If not empty, a CSV file (separated by ;) with one line per component is
+  // written: PO name, whether it is a candidate (or why not), Hamming
+  // distance to f_tilde_i and errors, BDD and AIG cone sizes of f_i and
+  // f_tilde_i, the profit under the chosen and under every metric, the
+  // selection and the time spent evaluating its profit. Values that were not
+  // computed are written as -.
+  std::string diagnostics_file;
+
+  // Only estimates and prints the selection without modifying the network.
+  // The global BDDs stay attached to the network.
+  bool dry_run = false;
 };
 
 SymmetricFunction
 CalculateSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
                            const BinomialCoefficients<ValueCount> &binomial);
 
-void Symmetrize(ComponentwiseSymmetrizationParameters parameters);
+// Calculates the nearest symmetric function for weighted C_H tables, where
+// totals[i] is the weighted amount of inputs with Hamming weight i
+SymmetricFunction
+CalculateSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
+                           const ValueCountsHW &totals);
+
+// Calculates the nearest function that is symmetric within each of the given
+// blocks from the block C_H tables of all components and the (weighted)
+// amounts of inputs for each vector of per-block weights
+BlockSymmetricFunction
+CalculateBlockSymmetricFunction(const std::vector<ValueCountsHW> &Ts,
+                                const InputBlocks &blocks,
+                                const ValueCountsHW &totals);
+
+// Summary of a symmetrization run as printed by Symmetrize (times in
+// seconds). For dry runs, aig_size_after is the AIG size of the unselected
+// components and t_aig is 0.
+struct SymmetrizationResult {
+  double t_symm = 0, t_aig = 0, t_bdd = 0, t_select = 0;
+  size_t aig_size_before = 0, aig_size_after = 0;
+  size_t bdd_size_before = 0, bdd_size_after = 0;
+  // Selection as printed, i.e., 1 for f_tilde_i and b for f_block_i
+  std::string selection;
+  double error = 0;
+};
+
+SymmetrizationResult
+Symmetrize(ComponentwiseSymmetrizationParameters parameters);
+
+struct SweepPoint {
+  std::string profit_metric;
+  double error_bound;
+
+  double error;
+  std::vector<bool> selection;
+  // Relative gap between the profit of the selection and the upper bound
+  // reported by the knapsack solver
+  double gap;
+  size_t aig_size;
+  size_t bdd_size;
+  size_t depth;
+
+  // True iff no other point is at least as good in error, AIG size, BDD size
+  // and depth and better in one of them
+  bool pareto_optimal = false;
+};
+
+struct SweepParameters {
+  // error_bound and profit_metric are ignored
+  ComponentwiseSymmetrizationParameters base;
+
+  std::vector<double> error_bounds;
+  std::vector<std::pair<std::string, ProfitMetric>> profit_metrics;
+
+  // Index of the point that replaces the current network of base.frame
+  std::optional<size_t> materialize;
+};
+
+// Computes f_tilde and the optimized AIG for it once and evaluates the
+// selection for every pair of profit metric and error bound. Leaves the
+// original network untouched unless a point shall be materialized.
+std::vector<SweepPoint> Sweep(const SweepParameters &parameters);
 
 } // namespace symmetrize
@@ -4,6 +4,7 @@
 
 #include "../../base/main/main.h"
 #include "../../base/main/mainInt.h"
+#include "../../base/io/ioAbc.h"
 #include "../../bdd/cudd/cudd.h"
 #include "../../bdd/cudd/cuddInt.h"
 
@@ -18,6 +19,21 @@ struct SymmetricFunction {
   size_t n, m;
   std::vector<ValueVector> components;
   std::vector<ValueCount> hamming_distances;
+  // Inputs that are complemented before counting the ones (none if empty)
+  std::vector<bool> inverted_inputs;
+};
+
+// Partition of (a subset of) the inputs into blocks of input indices
+using InputBlocks = std::vector<std::vector<int>>;
+
+// Function that is symmetric within each block of inputs. The value vectors
+// are indexed by the vector (w_0, ..., w_{k-1}) of per-block Hamming weights in
+// mixed radix, i.e., by sum_j w_j * prod_{l<j} (|B_l| + 1).
+struct BlockSymmetricFunction {
+  size_t n, m;
+  InputBlocks blocks;
+  std::vector<ValueVector> components;
+  std::vector<ValueCount> hamming_distances;
 };
 
 } // namespace symmetrize
@@ -0,0 +1,82 @@
+#include "budget.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace symmetrize {
+namespace utils {
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void RecordInterrupt(int) { interrupted = 1; }
+
+bool Interrupted() { return interrupted != 0; }
+
+InterruptHandler::InterruptHandler() {
+  interrupted = 0;
+  struct sigaction action = {};
+  action.sa_handler = RecordInterrupt;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, &previous_);
+}
+
+InterruptHandler::~InterruptHandler() { sigaction(SIGINT, &previous_, nullptr); }
+
+Budget::Budget(double seconds, size_t bytes)
+    : seconds_(seconds), bytes_(bytes), start_(Clock::now()),
+      phase_start_(start_) {}
+
+double Budget::Elapsed() const {
+  return std::chrono::duration<double>(Clock::now() - start_).count();
+}
+
+bool Budget::TimeExceeded(double fraction) const {
+  return seconds_ > 0 && Elapsed() > fraction * seconds_;
+}
+
+bool Budget::MemoryExceeded(size_t bytes_in_use) const {
+  return bytes_ > 0 && bytes_in_use > bytes_;
+}
+
+void Budget::StartPhase(const std::string &name, double until) {
+  phases_.push_back({name, until - until_, 0, 0});
+  until_ = until;
+  phase_start_ = Clock::now();
+}
+
+void Budget::EndPhase(size_t bytes_in_use) {
+  auto &phase = phases_.back();
+  phase.seconds =
+      std::chrono::duration<double>(Clock::now() - phase_start_).count();
+  phase.bytes = bytes_in_use;
+}
+
+std::string Budget::Report() const {
+  std::string report;
+  char buffer[128];
+  size_t peak = 0;
+  for (auto &phase : phases_) {
+    if (seconds_ > 0) {
+      snprintf(buffer, sizeof(buffer), "%s %.2fs (%.0f%% of %.2fs)",
+               phase.name.c_str(), phase.seconds,
+               100 * phase.seconds / (phase.share * seconds_),
+               phase.share * seconds_);
+    } else {
+      snprintf(buffer, sizeof(buffer), "%s %.2fs", phase.name.c_str(),
+               phase.seconds);
+    }
+    report += (report.empty() ? "" : ", ") + std::string(buffer);
+    peak = std::max(peak, phase.bytes);
+  }
+  if (bytes_ > 0) {
+    snprintf(buffer, sizeof(buffer), "; BDD memory %.1f of %.1f MB (%.0f%%)",
+             peak / 1048576.0, bytes_ / 1048576.0, 100.0 * peak / bytes_);
+  } else {
+    snprintf(buffer, sizeof(buffer), "; BDD memory %.1f MB",
+             peak / 1048576.0);
+  }
+  return report + buffer;
+}
+
+} // namespace utils
+} // namespace symmetrize
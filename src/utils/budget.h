@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+ * Contains utilities for running within wall clock and memory budgets and
+ * for reacting to SIGINT without terminating
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+
+namespace symmetrize {
+namespace utils {
+
+// Returns true iff SIGINT was received while an InterruptHandler was installed
+bool Interrupted();
+
+// Replaces the SIGINT handler by one that only records the interrupt (see
+// Interrupted()) for the lifetime of the object
+class InterruptHandler {
+public:
+  InterruptHandler();
+  ~InterruptHandler();
+
+  InterruptHandler(const InterruptHandler &) = delete;
+  InterruptHandler &operator=(const InterruptHandler &) = delete;
+
+private:
+  struct sigaction previous_;
+};
+
+// Wall clock and memory budget of a run that is split into consecutive
+// phases. Each phase may use the time budget until a given fraction of the
+// total budget has elapsed. A budget of 0 seconds or bytes is unlimited.
+class Budget {
+public:
+  struct Phase {
+    std::string name;
+    // Share of the total time budget
+    double share;
+    double seconds;
+    size_t bytes;
+  };
+
+  Budget(double seconds = 0, size_t bytes = 0);
+
+  bool IsLimited() const { return seconds_ > 0 || bytes_ > 0; }
+  size_t Bytes() const { return bytes_; }
+
+  // Wall clock time since construction in seconds
+  double Elapsed() const;
+
+  // True iff more than the given fraction of the time budget has elapsed
+  bool TimeExceeded(double fraction = 1) const;
+  bool MemoryExceeded(size_t bytes_in_use) const;
+
+  // True iff the run shall stop as soon as possible, i.e., the time budget
+  // is exhausted or SIGINT was received
+  bool Exhausted() const { return TimeExceeded() || Interrupted(); }
+
+  // Starts a phase that may run until the given fraction of the time budget
+  // has elapsed
+  void StartPhase(const std::string &name, double until);
+  // True iff the current phase has used up its share of the time budget
+  bool PhaseExceeded() const { return TimeExceeded(until_); }
+  // Ends the current phase, recording the memory in use at its end
+  void EndPhase(size_t bytes_in_use);
+
+  const std::vector<Phase> &Phases() const { return phases_; }
+
+  // One line summary of the time and memory used by each phase, relative to
+  // its share of the budget
+  std::string Report() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  double seconds_;
+  size_t bytes_;
+  Clock::time_point start_;
+
+  Clock::time_point phase_start_;
+  double until_ = 0;
+  std::vector<Phase> phases_;
+};
+
+} // namespace utils
+} // namespace symmetrize
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace symmetrize {
+namespace utils {
+
+// 64 bit FNV-1a hash. Unlike std::hash, the result is the same for every
+// build and run, hence it can be stored in files.
+class Hasher {
+public:
+  void Add(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      hash_ = (hash_ ^ ((value >> (8 * i)) & 0xff)) * 0x100000001b3ull;
+    }
+  }
+
+  uint64_t Get() const { return hash_; }
+
+private:
+  uint64_t hash_ = 0xcbf29ce484222325ull;
+};
+
+} // namespace utils
+} // namespace symmetrize
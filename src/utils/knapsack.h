@@ -1,27 +1,105 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <limits>
 #include <map>
 #include <stdexcept>
+#include <vector>
 
 namespace symmetrize {
 namespace utils {
 
+template <typename Weight> struct KnapsackSolution {
+  Weight weight = 0;
+  std::vector<bool> selection;
+  double profit = 0;
+  // Upper bound on the optimal profit
+  double bound = 0;
+
+  // Relative gap between the profit and the upper bound on the optimal profit
+  double Gap() const {
+    return bound > 0 ? std::max(0.0, (bound - profit) / bound) : 0;
+  }
+};
+
 template <typename Weight, typename Profit> class KnapsackSolver {
 
 public:
-  virtual std::pair<Weight, std::vector<bool>>
-  Solve(const std::vector<Weight> &weights, const std::vector<Profit> &profits,
-        Weight capacity) const = 0;
+  virtual ~KnapsackSolver() = default;
+
+  virtual KnapsackSolution<Weight>
+  Optimize(const std::vector<Weight> &weights,
+           const std::vector<Profit> &profits, Weight capacity) const = 0;
+
+  std::pair<Weight, std::vector<bool>> Solve(const std::vector<Weight> &weights,
+                                             const std::vector<Profit> &profits,
+                                             Weight capacity) const {
+    auto solution = Optimize(weights, profits, capacity);
+    return {solution.weight, solution.selection};
+  }
+
+protected:
+  // Indices of all objects with positive profit sorted by decreasing profit
+  // per weight
+  static std::vector<size_t> ByEfficiency(const std::vector<Weight> &weights,
+                                          const std::vector<Profit> &profits) {
+    if (weights.size() != profits.size())
+      throw std::invalid_argument("unequal amounts of weights and profits");
+    std::vector<size_t> order;
+    for (size_t i = 0; i < weights.size(); i++) {
+      if (profits[i] > 0)
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return (double)profits[a] * weights[b] > (double)profits[b] * weights[a];
+    });
+    return order;
+  }
+
+  // Upper bound of the linear relaxation for the objects order[from...] and
+  // the given remaining capacity
+  static double LinearBound(const std::vector<Weight> &weights,
+                            const std::vector<Profit> &profits,
+                            const std::vector<size_t> &order, size_t from,
+                            Weight capacity) {
+    double bound = 0;
+    for (size_t k = from; k < order.size(); k++) {
+      size_t i = order[k];
+      if (weights[i] <= capacity) {
+        capacity -= weights[i];
+        bound += profits[i];
+      } else {
+        bound += (double)profits[i] * capacity / weights[i];
+        break;
+      }
+    }
+    return bound;
+  }
+
+  static KnapsackSolution<Weight> Evaluate(const std::vector<Weight> &weights,
+                                           const std::vector<Profit> &profits,
+                                           std::vector<bool> selection) {
+    KnapsackSolution<Weight> solution;
+    for (size_t i = 0; i < selection.size(); i++) {
+      if (selection[i]) {
+        solution.weight += weights[i];
+        solution.profit += profits[i];
+      }
+    }
+    solution.selection = std::move(selection);
+    return solution;
+  }
 };
 
 template <typename Weight, typename Profit>
 class GreedyApproximateKnapsackSolver : public KnapsackSolver<Weight, Profit> {
 
 public:
-  std::pair<Weight, std::vector<bool>> Solve(const std::vector<Weight> &weights,
-                                             const std::vector<Profit> &profits,
-                                             Weight capacity) const override {
+  KnapsackSolution<Weight> Optimize(const std::vector<Weight> &weights,
+                                    const std::vector<Profit> &profits,
+                                    Weight capacity) const override {
     if (weights.size() != profits.size())
       throw std::invalid_argument("unequal amounts of weights and profits");
     std::vector<bool> res(weights.size(), false);
@@ -50,7 +128,274 @@ public:
       res[idx] = true;
     }
 
-    return {used_capacity, res};
+    auto solution = this->Evaluate(weights, profits, res);
+    solution.bound = this->LinearBound(
+        weights, profits, this->ByEfficiency(weights, profits), 0, capacity);
+    return solution;
+  }
+};
+
+// Depth first branch and bound using the bound of the linear relaxation.
+// Returns the best solution found so far if the time limit is reached.
+template <typename Weight, typename Profit>
+class BranchAndBoundKnapsackSolver : public KnapsackSolver<Weight, Profit> {
+
+public:
+  // A time limit of 0 means no limit
+  explicit BranchAndBoundKnapsackSolver(double time_limit = 0)
+      : time_limit_(time_limit) {}
+
+  KnapsackSolution<Weight> Optimize(const std::vector<Weight> &weights,
+                                    const std::vector<Profit> &profits,
+                                    Weight capacity) const override {
+    State s{weights, profits, this->ByEfficiency(weights, profits)};
+    s.deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                    std::chrono::duration<double>(time_limit_));
+    s.current.assign(weights.size(), false);
+
+    // The greedy solution serves as initial incumbent
+    auto greedy = GreedyApproximateKnapsackSolver<Weight, Profit>().Optimize(
+        weights, profits, capacity);
+    s.best = greedy.selection;
+    s.best_profit = greedy.profit;
+
+    double root_bound = this->LinearBound(weights, profits, s.order, 0, capacity);
+    Branch(s, 0, capacity, 0);
+
+    auto solution = this->Evaluate(weights, profits, s.best);
+    solution.bound = s.timed_out ? root_bound : solution.profit;
+    return solution;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct State {
+    const std::vector<Weight> &weights;
+    const std::vector<Profit> &profits;
+    std::vector<size_t> order;
+    Clock::time_point deadline;
+    std::vector<bool> current;
+    std::vector<bool> best;
+    double best_profit = 0;
+    size_t nodes = 0;
+    bool timed_out = false;
+  };
+
+  bool OutOfTime(State &s) const {
+    // Only check the clock every now and then
+    if (time_limit_ > 0 && ++s.nodes % 1024 == 0 && Clock::now() > s.deadline)
+      s.timed_out = true;
+    return s.timed_out;
+  }
+
+  void Branch(State &s, size_t k, Weight capacity, double profit) const {
+    if (profit > s.best_profit) {
+      s.best_profit = profit;
+      s.best = s.current;
+    }
+    if (k == s.order.size() || OutOfTime(s))
+      return;
+    double bound =
+        profit + this->LinearBound(s.weights, s.profits, s.order, k, capacity);
+    if (bound <= s.best_profit)
+      return;
+    size_t i = s.order[k];
+    if (s.weights[i] <= capacity) {
+      s.current[i] = true;
+      Branch(s, k + 1, capacity - s.weights[i], profit + s.profits[i]);
+      s.current[i] = false;
+    }
+    Branch(s, k + 1, capacity, profit);
+  }
+
+  double time_limit_;
+};
+
+// Dynamic program over weights scaled to integers in [0, resolution]. Weights
+// are rounded up, hence the solution always respects the capacity and is
+// optimal up to the rounding.
+template <typename Weight, typename Profit>
+class DynamicProgrammingKnapsackSolver : public KnapsackSolver<Weight, Profit> {
+
+public:
+  explicit DynamicProgrammingKnapsackSolver(size_t resolution = 10000)
+      : resolution_(resolution) {}
+
+  KnapsackSolution<Weight> Optimize(const std::vector<Weight> &weights,
+                                    const std::vector<Profit> &profits,
+                                    Weight capacity) const override {
+    auto order = this->ByEfficiency(weights, profits);
+    size_t R = capacity > 0 ? resolution_ : 0;
+    std::vector<size_t> scaled(weights.size());
+    for (size_t i : order) {
+      double w = capacity > 0 ? std::ceil((double)weights[i] / capacity * R)
+                              : (weights[i] > 0 ? R + 1 : 0);
+      scaled[i] = std::min<double>(w, R + 1);
+    }
+
+    // best[c] is the maximal profit with a scaled weight of at most c
+    std::vector<double> best(R + 1, 0);
+    std::vector<std::vector<bool>> taken(order.size(),
+                                         std::vector<bool>(R + 1, false));
+    for (size_t k = 0; k < order.size(); k++) {
+      size_t i = order[k];
+      if (scaled[i] > R)
+        continue;
+      for (size_t c = R + 1; c-- > scaled[i];) {
+        double with = best[c - scaled[i]] + profits[i];
+        if (with > best[c]) {
+          best[c] = with;
+          taken[k][c] = true;
+        }
+      }
+    }
+
+    std::vector<bool> selection(weights.size(), false);
+    size_t c = R;
+    for (size_t k = order.size(); k-- > 0;) {
+      if (taken[k][c]) {
+        selection[order[k]] = true;
+        c -= scaled[order[k]];
+      }
+    }
+    auto solution = this->Evaluate(weights, profits, selection);
+    solution.bound = this->LinearBound(weights, profits, order, 0, capacity);
+    return solution;
+  }
+
+private:
+  size_t resolution_;
+};
+
+template <typename Weight> struct MultipleChoiceKnapsackSolution {
+  static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+  Weight weight = 0;
+  // Index of the chosen object within each class or NONE
+  std::vector<size_t> choice;
+  double profit = 0;
+  // Upper bound on the optimal profit
+  double bound = 0;
+
+  double Gap() const {
+    return bound > 0 ? std::max(0.0, (bound - profit) / bound) : 0;
+  }
+};
+
+// Greedy solver for the multiple-choice knapsack problem, where at most one
+// object of each class may be chosen. Only objects on the upper convex hull
+// of their class are considered; the upgrades between consecutive hull
+// objects are applied by decreasing efficiency as long as they fit. The
+// bound is that of the linear relaxation.
+// see: P. Sinha and A. A. Zoltners, "The Multiple-Choice Knapsack Problem,"
+// in Operations Research, vol. 27, no. 3, pp. 503-515, 1979.
+template <typename Weight, typename Profit>
+class GreedyMultipleChoiceKnapsackSolver {
+
+public:
+  using Solution = MultipleChoiceKnapsackSolution<Weight>;
+
+  Solution Optimize(const std::vector<std::vector<Weight>> &weights,
+                    const std::vector<std::vector<Profit>> &profits,
+                    Weight capacity) const {
+    if (weights.size() != profits.size())
+      throw std::invalid_argument("unequal amounts of weights and profits");
+    Solution solution;
+    solution.choice.assign(weights.size(), Solution::NONE);
+
+    std::vector<Upgrade> upgrades;
+    for (size_t c = 0; c < weights.size(); c++) {
+      auto hull = Hull(weights[c], profits[c]);
+      Weight w = 0;
+      double p = 0;
+      for (size_t k : hull) {
+        upgrades.push_back(
+            {c, k, weights[c][k] - w, (double)profits[c][k] - p});
+        w = weights[c][k];
+        p = profits[c][k];
+      }
+    }
+    // Upgrades of a class have decreasing efficiency along the hull, hence
+    // stable sorting keeps their order
+    std::stable_sort(upgrades.begin(), upgrades.end(),
+                     [](const Upgrade &a, const Upgrade &b) {
+                       return a.profit * b.weight > b.profit * a.weight;
+                     });
+
+    // Classes whose next upgrade did not fit are not upgraded any further
+    std::vector<bool> blocked(weights.size(), false);
+    bool relaxed = false;
+    solution.bound = 0;
+    for (auto &u : upgrades) {
+      if (!relaxed) {
+        Weight remaining = capacity - solution.weight;
+        if (u.weight <= remaining) {
+          solution.bound += u.profit;
+        } else {
+          solution.bound += u.profit * remaining / u.weight;
+          relaxed = true;
+        }
+      }
+      if (blocked[u.c])
+        continue;
+      if (solution.weight + u.weight > capacity) {
+        blocked[u.c] = true;
+        continue;
+      }
+      solution.weight += u.weight;
+      solution.profit += u.profit;
+      solution.choice[u.c] = u.k;
+    }
+    return solution;
+  }
+
+private:
+  struct Upgrade {
+    size_t c, k;
+    Weight weight;
+    double profit;
+  };
+
+  // Indices of the objects on the upper convex hull of (0, 0) and the objects
+  // of a class, sorted by weight
+  static std::vector<size_t> Hull(const std::vector<Weight> &weights,
+                                  const std::vector<Profit> &profits) {
+    if (weights.size() != profits.size())
+      throw std::invalid_argument("unequal amounts of weights and profits");
+    std::vector<size_t> order;
+    for (size_t k = 0; k < weights.size(); k++) {
+      if (profits[k] > 0)
+        order.push_back(k);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return weights[a] < weights[b] ||
+             (weights[a] == weights[b] && profits[a] > profits[b]);
+    });
+
+    std::vector<size_t> hull;
+    auto weight = [&](size_t h) { return h == 0 ? 0 : weights[hull[h - 1]]; };
+    auto profit = [&](size_t h) {
+      return h == 0 ? 0.0 : (double)profits[hull[h - 1]];
+    };
+    for (size_t k : order) {
+      // Dominated by the last hull object
+      if (profits[k] <= profit(hull.size()))
+        continue;
+      // Remove hull objects below the line to k
+      while (!hull.empty()) {
+        size_t h = hull.size();
+        double slope_prev =
+            (profit(h) - profit(h - 1)) * (weights[k] - weight(h));
+        double slope_next =
+            (profits[k] - profit(h)) * (weight(h) - weight(h - 1));
+        if (slope_next < slope_prev)
+          break;
+        hull.pop_back();
+      }
+      hull.push_back(k);
+    }
+    return hull;
   }
 };
 
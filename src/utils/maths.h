@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace symmetrize {
 
@@ -19,6 +20,28 @@ template <typename T> T Log2(T i) {
 
 template <typename T> bool IsPow2(T i) { return i > 0 && ((i & (i - 1)) == 0); }
 
+// Strides of a mixed radix number system with the given radices where the
+// first digit is the least significant one. The additional last entry is the
+// amount of representable values.
+inline std::vector<size_t> MixedRadixStrides(const std::vector<size_t> &radices) {
+  std::vector<size_t> strides(radices.size() + 1, 1);
+  for (size_t j = 0; j < radices.size(); j++) {
+    strides[j + 1] = strides[j] * radices[j];
+  }
+  return strides;
+}
+
+// Radices |B_j| + 1 of the Hamming weights within the given blocks
+template <typename T>
+std::vector<size_t> BlockRadices(const std::vector<std::vector<T>> &blocks) {
+  std::vector<size_t> radices;
+  radices.reserve(blocks.size());
+  for (auto &block : blocks) {
+    radices.push_back(block.size() + 1);
+  }
+  return radices;
+}
+
 /**
  * Computes and holds all binomial coefficients i over j with i <= n and j <= n
  *
@@ -0,0 +1,167 @@
+#include "process.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../includes.h"
+
+namespace symmetrize {
+namespace utils {
+
+using Clock = std::chrono::steady_clock;
+
+struct Worker {
+  size_t job;
+  pid_t pid;
+  int fd;
+  Clock::time_point start;
+  std::string output;
+  bool eof = false;
+  bool exited = false;
+  bool killed = false;
+  int status = 0;
+};
+
+static void WriteAll(int fd, const std::string &data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t res = write(fd, data.data() + written, data.size() - written);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    written += res;
+  }
+}
+
+static Worker Spawn(size_t i, const ForkedJob &job,
+                    const std::vector<Worker> &running) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    throw std::runtime_error("could not create pipe for worker");
+  }
+  // Prevent buffered output from being printed by parent and child
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    throw std::runtime_error("could not fork worker");
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    for (auto &w : running) {
+      close(w.fd);
+    }
+    int code = 0;
+    std::string output;
+    try {
+      output = job(i);
+    } catch (std::exception &e) {
+      Abc_Print(ABC_ERROR, "Exception caught in worker: %s\n", e.what());
+      code = 1;
+    } catch (...) {
+      Abc_Print(ABC_ERROR, "Unknown exception caught in worker\n");
+      code = 1;
+    }
+    WriteAll(fds[1], output);
+    close(fds[1]);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(code);
+  }
+  close(fds[1]);
+  return {.job = i, .pid = pid, .fd = fds[0], .start = Clock::now()};
+}
+
+static void ReadAvailable(Worker &w) {
+  char buffer[4096];
+  ssize_t res = read(w.fd, buffer, sizeof(buffer));
+  if (res > 0) {
+    w.output.append(buffer, res);
+  } else if (res == 0 || errno != EINTR) {
+    w.eof = true;
+    close(w.fd);
+  }
+}
+
+static ForkedResult Finish(const Worker &w) {
+  ForkedResult result;
+  result.seconds =
+      std::chrono::duration<double>(Clock::now() - w.start).count();
+  if (w.killed) {
+    result.status = ForkedResult::Status::TIMEOUT;
+  } else if (WIFEXITED(w.status) && WEXITSTATUS(w.status) == 0) {
+    result.status = ForkedResult::Status::SUCCESS;
+    result.output = w.output;
+  }
+  return result;
+}
+
+std::vector<ForkedResult> RunForked(size_t n_jobs, size_t n_workers,
+                                    const ForkedJob &job, double timeout,
+                                    const ForkedCallback &on_done) {
+  n_workers = std::max<size_t>(n_workers, 1);
+  std::vector<ForkedResult> results(n_jobs);
+  std::vector<Worker> running;
+  size_t next = 0;
+  while (next < n_jobs || !running.empty()) {
+    while (next < n_jobs && running.size() < n_workers) {
+      running.push_back(Spawn(next++, job, running));
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<Worker *> polled;
+    for (auto &w : running) {
+      if (!w.eof) {
+        fds.push_back({w.fd, POLLIN, 0});
+        polled.push_back(&w);
+      }
+    }
+    if (!fds.empty() && poll(fds.data(), fds.size(), 100) > 0) {
+      for (size_t i = 0; i < fds.size(); i++) {
+        if (fds[i].revents != 0)
+          ReadAvailable(*polled[i]);
+      }
+    } else if (fds.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    for (auto it = running.begin(); it != running.end();) {
+      Worker &w = *it;
+      if (!w.exited && waitpid(w.pid, &w.status, WNOHANG) == w.pid) {
+        w.exited = true;
+      }
+      double elapsed =
+          std::chrono::duration<double>(Clock::now() - w.start).count();
+      if (!w.exited && !w.killed && timeout > 0 && elapsed > timeout) {
+        kill(w.pid, SIGKILL);
+        w.killed = true;
+      }
+      if (w.exited && w.eof) {
+        results[w.job] = Finish(w);
+        if (on_done)
+          on_done(w.job, results[w.job]);
+        it = running.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+  return results;
+}
+
+size_t HardwareConcurrency() {
+  return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+} // namespace utils
+} // namespace symmetrize
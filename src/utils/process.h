@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ * Contains utilities for running jobs in forked worker processes
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace symmetrize {
+namespace utils {
+
+struct ForkedResult {
+  enum class Status { SUCCESS, FAILURE, TIMEOUT };
+
+  Status status = Status::FAILURE;
+  // Everything the job returned (only meaningful on success)
+  std::string output;
+  // Wall clock time between fork and exit of the worker in seconds
+  double seconds = 0;
+};
+
+// Computes the output of job number i within a forked child process
+using ForkedJob = std::function<std::string(size_t i)>;
+
+// Called within the parent process as soon as job number i has finished
+using ForkedCallback = std::function<void(size_t i, const ForkedResult &)>;
+
+// Runs job(i) for each i in [0, n_jobs) in a freshly forked child process
+// with at most n_workers children running at the same time. The string
+// returned by a job is sent back to the parent through a pipe. A job throwing
+// an exception or exiting abnormally results in FAILURE. If timeout is
+// positive, children running longer than timeout seconds are killed and
+// reported as TIMEOUT.
+std::vector<ForkedResult> RunForked(size_t n_jobs, size_t n_workers,
+                                    const ForkedJob &job, double timeout = 0,
+                                    const ForkedCallback &on_done = nullptr);
+
+// Returns the number of concurrent threads supported by the machine (at
+// least 1)
+size_t HardwareConcurrency();
+
+} // namespace utils
+} // namespace symmetrize
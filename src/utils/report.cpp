@@ -0,0 +1,163 @@
+#include "report.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace symmetrize {
+namespace utils {
+
+static double Seconds(const timeval &time) {
+  return time.tv_sec + time.tv_usec / 1e6;
+}
+
+ResourceUsage ResourceUsage::Now() {
+  ResourceUsage usage;
+  struct rusage self, children;
+  getrusage(RUSAGE_SELF, &self);
+  getrusage(RUSAGE_CHILDREN, &children);
+  usage.cpu_seconds = Seconds(self.ru_utime) + Seconds(self.ru_stime) +
+                      Seconds(children.ru_utime) + Seconds(children.ru_stime);
+  // ru_maxrss is given in kilobytes
+  usage.peak_rss = (size_t)self.ru_maxrss * 1024;
+
+  // Second field of statm is the resident set size in pages
+  if (FILE *statm = fopen("/proc/self/statm", "r")) {
+    size_t size, resident;
+    if (fscanf(statm, "%zu %zu", &size, &resident) == 2) {
+      usage.rss = resident * sysconf(_SC_PAGESIZE);
+    }
+    fclose(statm);
+  }
+  return usage;
+}
+
+static std::string Quote(const std::string &txt) {
+  std::string res = "\"";
+  for (char c : txt) {
+    if (c == '"' || c == '\\') {
+      res += '\\';
+      res += c;
+    } else if ((unsigned char)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      res += escaped;
+    } else {
+      res += c;
+    }
+  }
+  return res + "\"";
+}
+
+Report::Report() : phase_start_(Clock::now()) {}
+
+void Report::SetRaw(const std::string &key, const std::string &json) {
+  for (auto &entry : entries_) {
+    if (entry.first == key) {
+      entry.second = json;
+      return;
+    }
+  }
+  entries_.emplace_back(key, json);
+}
+
+void Report::Set(const std::string &key, double value) {
+  if (!std::isfinite(value)) {
+    SetRaw(key, "null");
+    return;
+  }
+  char txt[32];
+  snprintf(txt, sizeof(txt), "%.10g", value);
+  SetRaw(key, txt);
+}
+
+void Report::Set(const std::string &key, size_t value) {
+  SetRaw(key, std::to_string(value));
+}
+
+void Report::Set(const std::string &key, const std::string &value) {
+  SetRaw(key, Quote(value));
+}
+
+void Report::Set(const std::string &key, const char *value) {
+  SetRaw(key, Quote(value));
+}
+
+void Report::Set(const std::string &key, const Report &object) {
+  SetRaw(key, object.ToJSON());
+}
+
+void Report::Set(const std::string &key,
+                 const std::vector<std::string> &values) {
+  std::string json = "[";
+  for (size_t i = 0; i < values.size(); i++) {
+    json += (i ? ", " : "") + Quote(values[i]);
+  }
+  SetRaw(key, json + "]");
+}
+
+void Report::SetFlag(const std::string &key, bool value) {
+  SetRaw(key, value ? "true" : "false");
+}
+
+void Report::StartPhase(const std::string &name) {
+  phase_ = name;
+  phase_start_ = Clock::now();
+  phase_usage_ = ResourceUsage::Now();
+}
+
+void Report::EndPhase() {
+  auto usage = ResourceUsage::Now();
+  Report phase;
+  phase.Set("name", phase_);
+  phase.Set("wall_seconds",
+            std::chrono::duration<double>(Clock::now() - phase_start_)
+                .count());
+  phase.Set("cpu_seconds", usage.cpu_seconds - phase_usage_.cpu_seconds);
+  phase.Set("rss_bytes", usage.rss);
+  // ru_maxrss is the peak of the whole process, not of the phase
+  phase.Set("process_peak_rss_bytes", usage.peak_rss);
+  phases_.push_back(phase);
+}
+
+// Indents all but the first line of json, which nests it one level deeper
+static std::string Indent(std::string json) {
+  for (size_t pos = 0; (pos = json.find('\n', pos)) != std::string::npos;
+       pos += 3) {
+    json.insert(pos + 1, "  ");
+  }
+  return json;
+}
+
+std::string Report::ToJSON() const {
+  auto entries = entries_;
+  if (!phases_.empty()) {
+    std::string array = "[\n";
+    for (size_t i = 0; i < phases_.size(); i++) {
+      array += "  " + Indent(phases_[i].ToJSON()) +
+               (i + 1 < phases_.size() ? ",\n" : "\n");
+    }
+    entries.emplace_back("phases", array + "]");
+  }
+  std::string json = "{\n";
+  for (size_t i = 0; i < entries.size(); i++) {
+    json += "  " + Quote(entries[i].first) + ": " + Indent(entries[i].second) +
+            (i + 1 < entries.size() ? ",\n" : "\n");
+  }
+  return json + "}";
+}
+
+void Report::Write(const std::string &filename) const {
+  std::ofstream out(filename);
+  out << ToJSON() << "\n";
+  if (!out) {
+    throw std::runtime_error("could not write report to " + filename);
+  }
+}
+
+} // namespace utils
+} // namespace symmetrize
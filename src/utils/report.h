@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * Contains a machine readable report of a run, written as JSON
+ */
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symmetrize {
+namespace utils {
+
+// Resources used by the process (including waited for children) so far
+struct ResourceUsage {
+  // User plus system time
+  double cpu_seconds = 0;
+  // Current and peak resident set size
+  size_t rss = 0;
+  size_t peak_rss = 0;
+
+  static ResourceUsage Now();
+};
+
+// JSON object whose entries keep their insertion order. Setting an existing
+// key replaces its value. Phases are timed from StartPhase to EndPhase and
+// written as the array "phases".
+class Report {
+public:
+  Report();
+
+  void Set(const std::string &key, double value);
+  void Set(const std::string &key, size_t value);
+  void Set(const std::string &key, const std::string &value);
+  void Set(const std::string &key, const char *value);
+  void Set(const std::string &key, const Report &object);
+  void Set(const std::string &key, const std::vector<std::string> &values);
+  void SetFlag(const std::string &key, bool value);
+
+  // Records wall and CPU time, the resident set size at the end of the phase
+  // and the peak resident set size of the process so far
+  void StartPhase(const std::string &name);
+  void EndPhase();
+  // The last phase, e.g., to add entries to it
+  Report &LastPhase() { return phases_.back(); }
+
+  std::string ToJSON() const;
+  // Throws std::runtime_error if the file cannot be written
+  void Write(const std::string &filename) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void SetRaw(const std::string &key, const std::string &json);
+
+  std::vector<std::pair<std::string, std::string>> entries_;
+  std::vector<Report> phases_;
+  std::string phase_;
+  Clock::time_point phase_start_;
+  ResourceUsage phase_usage_;
+};
+
+} // namespace utils
+} // namespace symmetrize
@@ -0,0 +1,95 @@
+#include "trace.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace symmetrize {
+namespace utils {
+
+bool tracing_enabled = false;
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+  const char *name;
+  int64_t start, duration;
+  std::vector<std::pair<const char *, double>> args;
+};
+
+static Clock::time_point trace_start;
+static std::vector<Event> events;
+
+// Microseconds since StartTracing
+static int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               trace_start)
+      .count();
+}
+
+void StartTracing() {
+  events.clear();
+  trace_start = Clock::now();
+  tracing_enabled = true;
+}
+
+static void WriteString(std::ostream &out, const char *txt) {
+  out << "\"";
+  for (; *txt; txt++) {
+    if (*txt == '"' || *txt == '\\')
+      out << "\\";
+    out << *txt;
+  }
+  out << "\"";
+}
+
+void StopTracing(const std::string &filename) {
+  tracing_enabled = false;
+  std::ofstream out(filename);
+  if (!out) {
+    throw std::runtime_error("could not write trace to " + filename);
+  }
+  out.precision(15);
+  // Events are recorded when they end, which the viewers do not mind
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  int pid = getpid();
+  for (size_t i = 0; i < events.size(); i++) {
+    auto &event = events[i];
+    out << "{\"name\": ";
+    WriteString(out, event.name);
+    out << ", \"ph\": \"X\", \"ts\": " << event.start
+        << ", \"dur\": " << event.duration << ", \"pid\": " << pid
+        << ", \"tid\": " << pid << ", \"args\": {";
+    for (size_t j = 0; j < event.args.size(); j++) {
+      out << (j ? ", " : "");
+      WriteString(out, event.args[j].first);
+      double value = event.args[j].second;
+      out << ": ";
+      if (std::isfinite(value))
+        out << value;
+      else
+        out << "null";
+    }
+    out << "}}" << (i + 1 < events.size() ? "," : "") << "\n";
+  }
+  out << "]}\n";
+  events.clear();
+}
+
+void Span::Begin(const char *name) {
+  name_ = name;
+  start_ = Now();
+}
+
+void Span::End() {
+  // Tracing may have been stopped while the span was open
+  if (!tracing_enabled)
+    return;
+  events.push_back({name_, start_, Now() - start_, std::move(args_)});
+}
+
+} // namespace utils
+} // namespace symmetrize
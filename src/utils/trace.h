@@ -0,0 +1,66 @@
+#pragma once
+
+/*
+ * Contains an opt-in tracer that records scoped spans as Chrome trace events
+ * (viewable in Perfetto or chrome://tracing)
+ */
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace symmetrize {
+namespace utils {
+
+extern bool tracing_enabled;
+
+// True iff spans are being recorded
+inline bool Tracing() { return tracing_enabled; }
+
+// Discards all spans recorded so far and starts recording
+void StartTracing();
+// Stops recording and writes the spans recorded since StartTracing as a
+// trace event JSON file. Spans of forked worker processes are not included.
+void StopTracing(const std::string &filename);
+
+// Records the time from construction until Stop() or destruction as a
+// complete event. If tracing is disabled, a span does not touch the clock or
+// allocate. Names and argument keys have to outlive the span (literals).
+class Span {
+public:
+  explicit Span(const char *name) : active_(Tracing()) {
+    if (active_)
+      Begin(name);
+  }
+  ~Span() { Stop(); }
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+  // Attaches an attribute shown with the span. Arguments are evaluated even
+  // if tracing is disabled, so guard expensive ones by Tracing().
+  Span &Arg(const char *key, double value) {
+    if (active_)
+      args_.emplace_back(key, value);
+    return *this;
+  }
+
+  void Stop() {
+    if (active_)
+      End();
+    active_ = false;
+  }
+
+private:
+  void Begin(const char *name);
+  void End();
+
+  bool active_;
+  const char *name_ = nullptr;
+  int64_t start_ = 0;
+  std::vector<std::pair<const char *, double>> args_;
+};
+
+} // namespace utils
+} // namespace symmetrize
@@ -1,10 +1,104 @@
 #include "truth_table.h"
 
 #include "../utils/maths.h"
-#include "array.h"
+#include "hash.h"
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace symmetrize {
+
+// +----------------------------------------------------------+
+// |                       Packed Table                       |
+// +----------------------------------------------------------+
+
+static uint64_t Mask(size_t length) {
+  return length >= 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1;
+}
+
+PackedTruthTable::PackedTruthTable(const TruthTable &table) {
+  words_.reserve((table.size() + 63) / 64);
+  for (auto e : table)
+    PushBack(e);
+}
+
+uint64_t PackedTruthTable::Bits(size_t begin, size_t length) const {
+  if (length == 0)
+    return 0;
+  size_t word = begin / 64, offset = begin % 64;
+  uint64_t bits = words_[word] >> offset;
+  if (offset != 0 && offset + length > 64)
+    bits |= words_[word + 1] << (64 - offset);
+  return bits & Mask(length);
+}
+
+void PackedTruthTable::AppendBits(uint64_t bits, size_t length) {
+  if (length == 0)
+    return;
+  bits &= Mask(length);
+  size_t offset = size_ % 64;
+  if (offset == 0) {
+    words_.push_back(bits);
+  } else {
+    words_.back() |= bits << offset;
+    if (offset + length > 64)
+      words_.push_back(bits >> (64 - offset));
+  }
+  size_ += length;
+}
+
+void PackedTruthTable::Append(const PackedTruthTable &table, size_t begin,
+                              size_t length) {
+  // Each chunk is read before it is appended, hence table may be this
+  for (size_t pos = 0; pos < length; pos += 64) {
+    size_t chunk = std::min<size_t>(64, length - pos);
+    AppendBits(table.Bits(begin + pos, chunk), chunk);
+  }
+}
+
+PackedTruthTable PackedTruthTable::Slice(size_t begin, size_t length) const {
+  PackedTruthTable res;
+  res.Append(*this, begin, length);
+  return res;
+}
+
+bool PackedTruthTable::Equal(size_t begin, const PackedTruthTable &other,
+                             size_t other_begin, size_t length) const {
+  for (size_t pos = 0; pos < length; pos += 64) {
+    size_t chunk = std::min<size_t>(64, length - pos);
+    if (Bits(begin + pos, chunk) != other.Bits(other_begin + pos, chunk))
+      return false;
+  }
+  return true;
+}
+
+bool PackedTruthTable::IsConstant(size_t begin, size_t length) const {
+  if (length == 0)
+    return true;
+  uint64_t expected = (*this)[begin] ? ~uint64_t(0) : 0;
+  for (size_t pos = 0; pos < length; pos += 64) {
+    size_t chunk = std::min<size_t>(64, length - pos);
+    if (Bits(begin + pos, chunk) != (expected & Mask(chunk)))
+      return false;
+  }
+  return true;
+}
+
+TruthTable PackedTruthTable::ToTruthTable() const {
+  TruthTable table(size_);
+  for (size_t i = 0; i < size_; i++)
+    table[i] = (*this)[i];
+  return table;
+}
+
+size_t PackedTruthTable::Hash::operator()(const PackedTruthTable &table) const {
+  utils::Hasher hasher;
+  hasher.Add(table.size_);
+  for (uint64_t word : table.words_)
+    hasher.Add(word);
+  return hasher.Get();
+}
+
 namespace tt {
 
 std::string ToString(const TruthTable &table, bool fill_dc) {
@@ -19,65 +113,78 @@ std::string ToString(const TruthTable &table, bool fill_dc) {
   return res;
 }
 
-using SubTable = utils::Array<TruthValue, TruthTable::const_iterator>;
+// +----------------------------------------------------------+
+// |                      FillMinBeads                        |
+// +----------------------------------------------------------+
 
-static void AppendOptimally(const TruthTable &T, TruthTable &target,
-                            size_t tau_begin, size_t tau_order) {
-  size_t tau_size = 1 << tau_order;
-  SubTable tau = SubTable(T).subarray(tau_begin);
-  if (tau.size() == tau_size)
+// Appends the don't cares of tau, the entries of T from tau_begin up to the
+// end, completing it to a subtable of the given order
+static void AppendOptimally(const PackedTruthTable &T,
+                            PackedTruthTable &target, size_t tau_begin,
+                            size_t tau_order) {
+  size_t tau_size = size_t(1) << tau_order;
+  size_t tau_length = T.size() - tau_begin;
+  if (tau_length == tau_size)
     return; // nothing to append
 
   if (tau_order == 0) {
-    target.emplace_back(tau.begin()[0]);
+    target.PushBack(T[tau_begin]);
     return;
   }
 
   // Right subtable only dont cares
   size_t subtable_size = tau_size / 2;
-  if (tau.size() <= subtable_size) {
+  if (tau_length <= subtable_size) {
     AppendOptimally(T, target, tau_begin, tau_order - 1);
-    SubTable new_tau_l = SubTable(target).subarray(tau_begin);
-    for (auto e : new_tau_l)
-      target.emplace_back(e);
+    target.Append(target, tau_begin, subtable_size);
     return;
   }
 
   // Left subtable starts with right subtable
-  SubTable tau_l = tau.first(subtable_size);
-  SubTable tau_r = tau.subarray(subtable_size);
-  if (tau_l.starts_with(tau_r)) {
-    for (size_t i = tau_r.size(); i < subtable_size; i++) {
-      target.emplace_back(tau_l.begin()[i]);
-    }
+  size_t right_length = tau_length - subtable_size;
+  if (T.Equal(tau_begin, T, tau_begin + subtable_size, right_length)) {
+    target.Append(T, tau_begin + right_length, subtable_size - right_length);
     return;
   }
 
-  // Fully specified subtable in T of same order as tau that starts with tau
-  size_t st_begin = 0;
-  while (T.size() - st_begin >= tau_size) {
-    SubTable st = SubTable(T).subarray(st_begin, tau_size);
-    if (st.starts_with(tau)) {
-      for (size_t i = tau.size(); i < tau_size; i++) {
-        target.emplace_back(st.begin()[i]);
-      }
-      return;
-    }
-    st_begin += tau_size;
+  // Fully specified subtable in T of same order as tau that starts with tau.
+  // Only the first subtable is tried, which keeps the tables (and hence the
+  // realized AIGs) of earlier versions.
+  if (T.size() >= tau_size && T.Equal(0, T, tau_begin, tau_length)) {
+    target.Append(T, tau_length, tau_size - tau_length);
+    return;
   }
 
   AppendOptimally(T, target, tau_begin + subtable_size, tau_order - 1);
 }
 
-TruthTable FillMinBeads(const TruthTable &table) {
+// Completed tables by the given ones, cleared once it grows too large
+static std::unordered_map<PackedTruthTable, PackedTruthTable,
+                          PackedTruthTable::Hash>
+    memo;
+static const size_t MEMO_LIMIT = 1 << 16;
+
+PackedTruthTable FillMinBeads(const PackedTruthTable &table) {
   if (table.empty()) {
     throw std::invalid_argument(
         "table has to have at least one specified value");
   }
-  TruthTable res = table;
+  auto it = memo.find(table);
+  if (it != memo.end())
+    return it->second;
+  PackedTruthTable res = table;
   AppendOptimally(table, res, 0, Log2(table.size()));
+  if (memo.size() >= MEMO_LIMIT)
+    memo.clear();
+  memo.emplace(table, res);
   return res;
 }
 
+TruthTable FillMinBeads(const TruthTable &table) {
+  return FillMinBeads(PackedTruthTable(table)).ToTruthTable();
+}
+
+void ClearFillMinBeadsMemo() { memo.clear(); }
+
 } // namespace tt
 } // namespace symmetrize
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -10,11 +11,63 @@ namespace symmetrize {
 // tt[i] is value of f(i_{bin})
 using TruthTable = std::vector<TruthValue>;
 
+// Truth table with 64 entries per word, entry i is bit i % 64 of word i / 64.
+// Ranges of entries are compared and copied a word at a time. Bits beyond the
+// size are always zero.
+class PackedTruthTable {
+public:
+  PackedTruthTable() = default;
+  explicit PackedTruthTable(const TruthTable &table);
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool operator[](size_t i) const { return (words_[i / 64] >> (i % 64)) & 1; }
+
+  void PushBack(bool value) { AppendBits(value, 1); }
+  // Appends the entries [begin, begin + length) of table, which may be this
+  // table itself
+  void Append(const PackedTruthTable &table, size_t begin, size_t length);
+  // The entries [begin, begin + length)
+  PackedTruthTable Slice(size_t begin, size_t length) const;
+
+  // True iff the entries [begin, begin + length) equal the entries
+  // [other_begin, other_begin + length) of other
+  bool Equal(size_t begin, const PackedTruthTable &other, size_t other_begin,
+             size_t length) const;
+  // True iff the entries [begin, begin + length) all have the same value
+  bool IsConstant(size_t begin, size_t length) const;
+
+  TruthTable ToTruthTable() const;
+
+  friend bool operator==(const PackedTruthTable &a,
+                         const PackedTruthTable &b) {
+    return a.size_ == b.size_ && a.words_ == b.words_;
+  }
+
+  struct Hash {
+    size_t operator()(const PackedTruthTable &table) const;
+  };
+
+private:
+  // The entries [begin, begin + length) as the low bits, length <= 64
+  uint64_t Bits(size_t begin, size_t length) const;
+  void AppendBits(uint64_t bits, size_t length);
+
+  std::vector<uint64_t> words_;
+  size_t size_ = 0;
+};
+
 namespace tt {
 
 std::string ToString(const TruthTable &table, bool fill_dc = false);
 
+// Completes the table to the next power of two, choosing the don't cares such
+// that few distinct subtables (beads) arise. Results are memoized by the
+// given table, as components often share their value vectors.
+PackedTruthTable FillMinBeads(const PackedTruthTable &table);
 TruthTable FillMinBeads(const TruthTable &table);
+// Forgets all memoized tables, e.g., to measure FillMinBeads
+void ClearFillMinBeadsMemo();
 
 } // namespace tt
 
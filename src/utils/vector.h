@@ -36,5 +36,17 @@ std::vector<T> Select(const std::vector<T> &t, const std::vector<T> &f,
   return res;
 }
 
+// Returns the entries of v at the given indices
+template <typename T>
+std::vector<T> Subset(const std::vector<T> &v,
+                      const std::vector<size_t> &indices) {
+  std::vector<T> res;
+  res.reserve(indices.size());
+  for (size_t i : indices) {
+    res.emplace_back(v.at(i));
+  }
+  return res;
+}
+
 } // namespace utils
 } // namespace symmetrize